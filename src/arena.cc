@@ -0,0 +1,116 @@
+#include "arena.hh"
+
+#include <algorithm>
+
+Arena::Arena(size_t chunk_size)
+    : m_chunk_size(chunk_size)
+{
+    add_chunk(chunk_size);
+}
+
+// static
+Arena &Arena::scratch()
+{
+    thread_local Arena arena;
+    return arena;
+}
+
+void *Arena::allocate(size_t size, size_t align)
+{
+    while (true)
+    {
+        auto &chunk = m_chunks[m_chunk];
+        uintptr_t base = reinterpret_cast<uintptr_t>(chunk.data.get());
+        size_t offset = ((base + m_offset + align - 1) & ~(uintptr_t)(align - 1)) - base;
+
+        if (offset + size <= chunk.size)
+        {
+            m_offset = offset + size;
+            return chunk.data.get() + offset;
+        }
+
+        // Continue in the next chunk, a new one is added if this was the last one or if it's too small
+        if (m_chunk + 1 == m_chunks.size() || m_chunks[m_chunk + 1].size < size + align)
+        {
+            add_chunk(size + align);
+        }
+
+        m_chunk++;
+        m_offset = 0;
+    }
+}
+
+void Arena::deallocate(void *ptr, size_t size)
+{
+    auto p = static_cast<uint8_t *>(ptr);
+
+    if (p + size == m_chunks[m_chunk].data.get() + m_offset)
+    {
+        m_offset -= size;
+    }
+}
+
+Arena::Mark Arena::mark() const
+{
+    return {m_chunk, m_offset};
+}
+
+void Arena::rewind(const Mark &mark)
+{
+    m_chunk = mark.chunk;
+    m_offset = mark.offset;
+}
+
+void Arena::reset()
+{
+    if (m_chunks.size() > 1)
+    {
+        // Replace the chunks with one that holds everything that was needed during the last tick
+        size_t total = capacity();
+        m_chunks.clear();
+        add_chunk(total);
+    }
+
+    m_chunk = 0;
+    m_offset = 0;
+}
+
+size_t Arena::used() const
+{
+    size_t total = m_offset;
+
+    for (size_t i = 0; i < m_chunk; i++)
+    {
+        total += m_chunks[i].size;
+    }
+
+    return total;
+}
+
+size_t Arena::capacity() const
+{
+    size_t total = 0;
+
+    for (const auto &c : m_chunks)
+    {
+        total += c.size;
+    }
+
+    return total;
+}
+
+void Arena::add_chunk(size_t min_size)
+{
+    // Chunks are added to the position after the current one, any chunks after it are too small to be used
+    size_t size = std::max({min_size, m_chunk_size, m_chunks.empty() ? 0 : m_chunks.back().size * 2});
+    Chunk chunk{std::unique_ptr<uint8_t[]>(new uint8_t[size]), size};
+
+    if (m_chunks.empty())
+    {
+        m_chunks.push_back(std::move(chunk));
+    }
+    else
+    {
+        m_chunks.insert(m_chunks.begin() + m_chunk + 1, std::move(chunk));
+    }
+}
@@ -0,0 +1,135 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+// A bump allocator for temporary data. Allocating is a pointer increment and nothing is freed individually,
+// everything is released at once with reset() or back to an earlier point with rewind(). When the memory runs
+// out a new chunk is added and on the next reset() the chunks are merged into one that's large enough for the
+// whole tick, after a few ticks the arena doesn't allocate anything from the heap.
+class Arena
+{
+public:
+    // A position in the arena that can be rewound to
+    struct Mark
+    {
+        size_t chunk;
+        size_t offset;
+    };
+
+    Arena(size_t chunk_size = 64 * 1024);
+
+    Arena(const Arena &) = delete;
+    Arena &operator=(const Arena &) = delete;
+
+    // The arena for temporary geometry, one per thread. It's reset at the start of every tick.
+    static Arena &scratch();
+
+    void *allocate(size_t size, size_t align);
+
+    // Gives back the memory if it was the latest allocation, otherwise does nothing
+    void deallocate(void *ptr, size_t size);
+
+    Mark mark() const;
+
+    // Frees everything that was allocated after the mark
+    void rewind(const Mark &mark);
+
+    // Frees everything
+    void reset();
+
+    // The number of bytes in use and the total size of the chunks
+    size_t used() const;
+    size_t capacity() const;
+
+private:
+    struct Chunk
+    {
+        std::unique_ptr<uint8_t[]> data;
+        size_t size;
+    };
+
+    void add_chunk(size_t min_size);
+
+    std::vector<Chunk> m_chunks;
+    size_t m_chunk = 0;
+    size_t m_offset = 0;
+    size_t m_chunk_size;
+};
+
+// Frees the temporary allocations made during its lifetime
+class ArenaScope
+{
+public:
+    ArenaScope(Arena &arena = Arena::scratch())
+        : m_arena(arena), m_mark(arena.mark())
+    {
+    }
+
+    ArenaScope(const ArenaScope &) = delete;
+    ArenaScope &operator=(const ArenaScope &) = delete;
+
+    ~ArenaScope()
+    {
+        m_arena.rewind(m_mark);
+    }
+
+private:
+    Arena &m_arena;
+    Arena::Mark m_mark;
+};
+
+// A standard allocator that allocates from an arena
+template <class T>
+class ArenaAllocator
+{
+public:
+    using value_type = T;
+
+    ArenaAllocator(Arena &arena = Arena::scratch())
+        : m_arena(&arena)
+    {
+    }
+
+    template <class U>
+    ArenaAllocator(const ArenaAllocator<U> &other)
+        : m_arena(other.arena())
+    {
+    }
+
+    T *allocate(size_t n)
+    {
+        return static_cast<T *>(m_arena->allocate(n * sizeof(T), alignof(T)));
+    }
+
+    void deallocate(T *ptr, size_t n)
+    {
+        m_arena->deallocate(ptr, n * sizeof(T));
+    }
+
+    Arena *arena() const
+    {
+        return m_arena;
+    }
+
+    template <class U>
+    bool operator==(const ArenaAllocator<U> &rhs) const
+    {
+        return m_arena == rhs.arena();
+    }
+
+    template <class U>
+    bool operator!=(const ArenaAllocator<U> &rhs) const
+    {
+        return m_arena != rhs.arena();
+    }
+
+private:
+    Arena *m_arena;
+};
+
+// A vector that lives in the scratch arena, it must not outlive the tick or the ArenaScope it was created in
+template <class T>
+using ScratchVector = std::vector<T, ArenaAllocator<T>>;
@@ -0,0 +1,377 @@
+#include "batch.hh"
+#include "arena.hh"
+#include "entities.hh"
+#include "scheduler.hh"
+#include "world.hh"
+
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+namespace
+{
+    using Clock = std::chrono::steady_clock;
+
+    // Limits for the values in the scenario files. The timings of every tick are kept until the report is written.
+    constexpr int64_t MAX_TICKS = 10000000;
+    constexpr int64_t MAX_REPEAT = 100000;
+
+    // The outcome of one run of a scenario
+    struct JobResult
+    {
+        size_t walls = 0;
+        size_t agents = 0;
+        uint64_t ticks = 0;
+        double build_ms = 0;
+        double run_ms = 0;
+        std::vector<float> tick_us;
+        size_t contacts = 0;
+        size_t reached = 0;
+        size_t blocked = 0;
+        size_t unfinished = 0;
+    };
+
+    double ms_since(Clock::time_point start)
+    {
+        return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+    }
+
+    JobResult run_job(const BatchScenario &scenario, uint64_t seed)
+    {
+        JobResult result;
+        auto start = Clock::now();
+
+        // Everything the job touches lives in its own world, the only thing shared with the other jobs is the
+        // allocator of the entities which is thread-safe
+        World world;
+        std::vector<std::unique_ptr<Wall>> walls;
+        std::vector<std::unique_ptr<Navigator>> navigators;
+
+        GeneratorOptions generator = scenario.generator;
+        generator.seed = seed;
+        auto scene = generate_scene(generator);
+        create_entities(world, nullptr, scene.view(), walls, navigators);
+
+        Random rng(seed);
+
+        for (auto &n : navigators)
+        {
+            if (n->is_active())
+            {
+                n->set_goal({rng.uniform(0, generator.width), rng.uniform(0, generator.height)});
+            }
+        }
+
+        result.walls = walls.size();
+        result.agents = navigators.size();
+        result.build_ms = ms_since(start);
+        result.tick_us.reserve(scenario.ticks);
+        start = Clock::now();
+
+        for (uint64_t tick = 0; tick < scenario.ticks; tick++)
+        {
+            auto tick_start = Clock::now();
+            world.clear_contacts();
+            Arena::scratch().reset();
+            size_t awake = 0;
+
+            for (Object *o : world.objects())
+            {
+                if (o->mobility() == Object::Mobility::DYNAMIC && o->is_active() && !o->is_sleeping())
+                {
+                    o->tick(1);
+                    awake += !o->is_sleeping();
+                }
+            }
+
+            result.tick_us.push_back(std::chrono::duration<float, std::micro>(Clock::now() - tick_start).count());
+            result.contacts += world.contacts().size();
+            result.ticks++;
+
+            if (awake == 0)
+            {
+                break;
+            }
+        }
+
+        result.run_ms = ms_since(start);
+
+        for (const auto &n : navigators)
+        {
+            switch (n->goal_state())
+            {
+            case Navigator::GoalState::REACHED:
+                result.reached++;
+                break;
+
+            case Navigator::GoalState::BLOCKED:
+                result.blocked++;
+                break;
+
+            case Navigator::GoalState::MOVING:
+                result.unfinished++;
+                break;
+
+            case Navigator::GoalState::NONE:
+                break;
+            }
+        }
+
+        return result;
+    }
+
+    void report_scenario(std::ostream &out, const BatchScenario &scenario, const std::vector<JobResult> &results)
+    {
+        std::vector<float> tick_us;
+        double walls = 0, agents = 0, ticks = 0, build_ms = 0, run_ms = 0, run_ms_max = 0, contacts = 0;
+        double reached = 0, blocked = 0, unfinished = 0;
+
+        for (const auto &r : results)
+        {
+            tick_us.insert(tick_us.end(), r.tick_us.begin(), r.tick_us.end());
+            walls += r.walls;
+            agents += r.agents;
+            ticks += r.ticks;
+            build_ms += r.build_ms;
+            run_ms += r.run_ms;
+            run_ms_max = std::max(run_ms_max, r.run_ms);
+            contacts += r.contacts;
+            reached += r.reached;
+            blocked += r.blocked;
+            unfinished += r.unfinished;
+        }
+
+        std::sort(tick_us.begin(), tick_us.end());
+        double n = std::max<size_t>(1, results.size());
+        double goals = std::max(1.0, reached + blocked + unfinished);
+
+        out << scenario.name << "," << results.size() << "," << walls / n << "," << agents / n << ","
+            << ticks / n << "," << build_ms / n << "," << run_ms / n << "," << run_ms_max << ","
+            << percentile(tick_us, 0.5) << "," << percentile(tick_us, 0.9) << "," << percentile(tick_us, 0.99) << ","
+            << (tick_us.empty() ? 0 : tick_us.back()) << "," << contacts / std::max(1.0, ticks) << ","
+            << reached / goals << "," << blocked / goals << "," << unfinished / goals << std::endl;
+    }
+}
+
+std::vector<BatchScenario> load_batch(const std::string &filename)
+{
+    std::ifstream file(filename);
+
+    if (!file)
+    {
+        throw Error("Could not open " + filename);
+    }
+
+    std::vector<BatchScenario> scenarios;
+    std::string line;
+    int line_number = 0;
+
+    while (std::getline(file, line))
+    {
+        line_number++;
+        std::istringstream in(line);
+        std::string token;
+        BatchScenario s;
+        bool empty = true;
+
+        while (in >> token)
+        {
+            if (empty && token[0] == '#')
+            {
+                break;
+            }
+
+            empty = false;
+            auto where = filename + ":" + std::to_string(line_number);
+            auto eq = token.find('=');
+
+            if (eq == std::string::npos)
+            {
+                throw Error(where + ": Expected key=value, got " + token);
+            }
+
+            auto key = token.substr(0, eq);
+            auto value = token.substr(eq + 1);
+
+            // A whole number in the range [lo, hi]
+            auto integer = [&](int64_t lo, int64_t hi)
+            {
+                size_t end = 0;
+                int64_t result = 0;
+
+                try
+                {
+                    result = std::stoll(value, &end);
+                }
+                catch (const std::exception &e)
+                {
+                    end = 0;
+                }
+
+                if (end == 0 || end != value.size() || result < lo || result > hi)
+                {
+                    throw Error(where + ": " + key + " must be a whole number between " + std::to_string(lo) +
+                                " and " + std::to_string(hi) + ", got " + value);
+                }
+
+                return result;
+            };
+
+            // A finite number in the range (0, hi]
+            auto positive = [&](double hi)
+            {
+                size_t end = 0;
+                double result = 0;
+
+                try
+                {
+                    result = std::stod(value, &end);
+                }
+                catch (const std::exception &e)
+                {
+                    end = 0;
+                }
+
+                // Written so that NaN fails the check too
+                if (end == 0 || end != value.size() || !(result > 0 && result <= hi))
+                {
+                    throw Error(where + ": " + key + " must be greater than 0 and at most " + std::to_string((int)hi) +
+                                ", got " + value);
+                }
+
+                return result;
+            };
+
+            if (key == "name")
+            {
+                s.name = value;
+            }
+            else if (key == "layout")
+            {
+                s.generator.layout = GeneratorOptions::parse_layout(value);
+            }
+            else if (key == "seed")
+            {
+                // Seeds use all 64 bits, a double would round the large ones
+                size_t end = 0;
+
+                try
+                {
+                    s.generator.seed = std::stoull(value, &end);
+                }
+                catch (const std::exception &e)
+                {
+                    end = 0;
+                }
+
+                if (end == 0 || end != value.size() || value.find('-') != std::string::npos)
+                {
+                    throw Error(where + ": Invalid value for " + key + ": " + value);
+                }
+            }
+            else if (key == "agents")
+            {
+                s.generator.agents = integer(0, GeneratorOptions::MAX_OBJECTS);
+            }
+            else if (key == "walls")
+            {
+                s.generator.walls = integer(0, GeneratorOptions::MAX_OBJECTS);
+            }
+            else if (key == "width")
+            {
+                s.generator.width = positive(GeneratorOptions::MAX_SIZE);
+            }
+            else if (key == "height")
+            {
+                s.generator.height = positive(GeneratorOptions::MAX_SIZE);
+            }
+            else if (key == "cell")
+            {
+                s.generator.cell = positive(GeneratorOptions::MAX_SIZE);
+            }
+            else if (key == "ticks")
+            {
+                s.ticks = integer(1, MAX_TICKS);
+            }
+            else if (key == "repeat")
+            {
+                s.repeat = integer(1, MAX_REPEAT);
+            }
+            else
+            {
+                throw Error(where + ": Unknown key " + key);
+            }
+        }
+
+        if (!empty)
+        {
+            // The sizes can be fine on their own and still be too many cells together
+            try
+            {
+                s.generator.validate();
+            }
+            catch (const Error &e)
+            {
+                throw Error(filename + ":" + std::to_string(line_number) + ": " + e.what());
+            }
+
+            if (s.name.empty())
+            {
+                s.name = "line" + std::to_string(line_number);
+            }
+
+            scenarios.push_back(s);
+        }
+    }
+
+    return scenarios;
+}
+
+void run_batch(const std::vector<BatchScenario> &scenarios, size_t threads, std::ostream &report)
+{
+    std::vector<std::vector<JobResult>> results(scenarios.size());
+    std::vector<WorkStealingPool::Task> tasks;
+    std::vector<double> busy_ms;
+
+    for (size_t i = 0; i < scenarios.size(); i++)
+    {
+        results[i].resize(scenarios[i].repeat);
+
+        for (int r = 0; r < scenarios[i].repeat; r++)
+        {
+            tasks.push_back([&, i, r]()
+                            {
+                                auto start = Clock::now();
+                                results[i][r] = run_job(scenarios[i], scenarios[i].generator.seed + r);
+                                busy_ms[WorkStealingPool::worker()] += ms_since(start); });
+        }
+    }
+
+    WorkStealingPool pool(threads);
+    busy_ms.resize(pool.threads());
+    size_t jobs = tasks.size();
+    auto start = Clock::now();
+    pool.run(std::move(tasks));
+    double wall_ms = ms_since(start);
+
+    report << "scenario,jobs,walls,agents,ticks,build_ms,run_ms,run_ms_max,tick_p50_us,tick_p90_us,tick_p99_us,"
+           << "tick_max_us,contacts_per_tick,reached,blocked,unfinished" << std::endl;
+
+    for (size_t i = 0; i < scenarios.size(); i++)
+    {
+        report_scenario(report, scenarios[i], results[i]);
+    }
+
+    double total_ms = 0;
+
+    for (double ms : busy_ms)
+    {
+        total_ms += ms;
+    }
+
+    std::cout << "Ran " << jobs << " jobs on " << pool.threads() << " threads in " << wall_ms / 1000 << "s, "
+              << total_ms / 1000 << "s of work (" << total_ms / std::max(1e-9, wall_ms) << "x), "
+              << pool.steals() << " steals" << std::endl;
+}
@@ -0,0 +1,31 @@
+#pragma once
+
+#include "generator.hh"
+
+#include <ostream>
+#include <string>
+#include <vector>
+
+// A headless experiment: a generated scene where every navigator is sent towards a random goal. The world is
+// ticked until every navigator has either reached its goal or been stopped by a collision, or until the tick
+// limit runs out.
+struct BatchScenario
+{
+    std::string name;
+    GeneratorOptions generator;
+    uint64_t ticks = 1000;
+
+    // Runs the scenario this many times, each time with the next seed
+    int repeat = 1;
+};
+
+// Reads the scenarios from a text file with one scenario per line. A line is a list of key=value pairs where
+// the keys are the names of the scene generation options without the dashes, along with name, ticks and
+// repeat. Empty lines and lines starting with # are skipped.
+//
+//   name=maze-small layout=maze width=2000 height=2000 agents=200 ticks=2000 repeat=8
+std::vector<BatchScenario> load_batch(const std::string &filename);
+
+// Runs every repeat of every scenario in a world of its own, spread over the given number of threads (zero
+// for one per core). The timings and the outcomes are aggregated per scenario and written as CSV.
+void run_batch(const std::vector<BatchScenario> &scenarios, size_t threads, std::ostream &report);
@@ -0,0 +1,46 @@
+#include "allocations.hh"
+
+#include <cstdlib>
+#include <new>
+
+// The replacements live in a translation unit of their own so that they can't be inlined into the code that
+// allocates. Once inlined, GCC sees std::free() called on a pointer from operator new and warns about it.
+
+namespace
+{
+    uint64_t s_allocs = 0;
+    uint64_t s_bytes = 0;
+}
+
+void *operator new(std::size_t size)
+{
+    ++s_allocs;
+    s_bytes += size;
+
+    if (void *ptr = std::malloc(size ? size : 1))
+    {
+        return ptr;
+    }
+
+    throw std::bad_alloc();
+}
+
+void operator delete(void *ptr) noexcept
+{
+    std::free(ptr);
+}
+
+void operator delete(void *ptr, std::size_t) noexcept
+{
+    std::free(ptr);
+}
+
+uint64_t allocation_count()
+{
+    return s_allocs;
+}
+
+uint64_t allocated_bytes()
+{
+    return s_bytes;
+}
@@ -0,0 +1,8 @@
+#pragma once
+
+#include <cstdint>
+
+// Every heap allocation in the process goes through the replacement operator new in allocations.cc, these are
+// the running totals. Read them before and after a timed run.
+uint64_t allocation_count();
+uint64_t allocated_bytes();
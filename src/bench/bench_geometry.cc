@@ -0,0 +1,400 @@
+#include "../objects.hh"
+#include "../world.hh"
+#include "allocations.hh"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <functional>
+#include <iostream>
+#include <limits>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace
+{
+    constexpr double PI = 3.14159265358979323846;
+
+    // Results are added to this so that the compiler can't remove the benchmarked code
+    volatile double s_sink = 0;
+
+    struct Options
+    {
+        bool json = false;
+        std::string filter;
+        double min_time_ms = 50;
+        int repeats = 3;
+        uint64_t seed = 1;
+    };
+
+    struct BenchObject : public Object
+    {
+    public:
+        BenchObject(World &world, std::vector<Point> pts, Mobility mobility = Mobility::DYNAMIC)
+            : Object(world, std::move(pts), mobility)
+        {
+        }
+
+        void tick(int steps)
+        {
+        }
+
+        void state_changed(Object::ChangeType type)
+        {
+        }
+    };
+
+    // A star-shaped polygon with the given number of vertices that fits inside a square of size 2 * radius. The
+    // vertices alternate between the full and the half radius so that the polygon is not convex.
+    std::vector<Point> star(std::mt19937_64 &rng, int vertices, double radius)
+    {
+        std::vector<Point> pts;
+        double offset = (rng() >> 11) * 0x1.0p-53 * 2 * PI / vertices;
+
+        for (int i = 0; i < vertices; i++)
+        {
+            double a = offset + i * 2 * PI / vertices;
+            double r = i % 2 ? radius * 0.5 : radius;
+            pts.emplace_back(radius + cos(a) * r, radius + sin(a) * r);
+        }
+
+        return pts;
+    }
+
+    class Runner
+    {
+    public:
+        Runner(const Options &options)
+            : m_options(options)
+        {
+            if (m_options.json)
+            {
+                std::cout << "[" << std::endl;
+            }
+            else
+            {
+                std::cout << "benchmark,param,iterations,ns_per_op,allocs_per_op,bytes_per_op,scaling" << std::endl;
+            }
+        }
+
+        ~Runner()
+        {
+            if (m_options.json)
+            {
+                std::cout << std::endl
+                          << "]" << std::endl;
+            }
+        }
+
+        // Runs the function repeatedly until it has run for at least the minimum time and reports the fastest of
+        // the repeated runs. The scaling is the local exponent of the cost against the parameter: 1 is linear, 2
+        // is quadratic and so on.
+        void run(const std::string &name, int param, const std::function<void()> &func)
+        {
+            if (!m_options.filter.empty() && name.find(m_options.filter) == std::string::npos)
+            {
+                return;
+            }
+
+            uint64_t iterations = calibrate(func);
+            double best = std::numeric_limits<double>::max();
+            uint64_t allocs = 0;
+            uint64_t bytes = 0;
+
+            for (int r = 0; r < m_options.repeats; r++)
+            {
+                uint64_t allocs_before = allocation_count();
+                uint64_t bytes_before = allocated_bytes();
+                double ns = time(func, iterations);
+
+                if (ns < best)
+                {
+                    best = ns;
+                    allocs = allocation_count() - allocs_before;
+                    bytes = allocated_bytes() - bytes_before;
+                }
+            }
+
+            double ns_per_op = best / iterations;
+            double scaling = std::nan("");
+
+            if (name == m_prev_name && param != m_prev_param && m_prev_ns > 0)
+            {
+                scaling = log(ns_per_op / m_prev_ns) / log((double)param / m_prev_param);
+            }
+
+            m_prev_name = name;
+            m_prev_param = param;
+            m_prev_ns = ns_per_op;
+
+            report(name, param, iterations, ns_per_op, (double)allocs / iterations, (double)bytes / iterations, scaling);
+        }
+
+    private:
+        double time(const std::function<void()> &func, uint64_t iterations)
+        {
+            auto start = std::chrono::steady_clock::now();
+
+            for (uint64_t i = 0; i < iterations; i++)
+            {
+                func();
+            }
+
+            return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+        }
+
+        uint64_t calibrate(const std::function<void()> &func)
+        {
+            uint64_t iterations = 1;
+            double target = m_options.min_time_ms * 1e6;
+
+            while (true)
+            {
+                double ns = time(func, iterations);
+
+                if (ns >= target || iterations >= (1ULL << 40))
+                {
+                    return iterations;
+                }
+
+                // Aim slightly past the target so that the next round is usually the last one
+                double factor = ns > 0 ? target * 1.2 / ns : 10;
+                iterations = std::max(iterations * 2, (uint64_t)(iterations * std::min(factor, 100.0)));
+            }
+        }
+
+        void report(const std::string &name, int param, uint64_t iterations, double ns, double allocs, double bytes,
+                    double scaling)
+        {
+            if (m_options.json)
+            {
+                std::cout << (m_first ? "" : ",\n")
+                          << "{\"benchmark\":\"" << name << "\",\"param\":" << param
+                          << ",\"iterations\":" << iterations << ",\"ns_per_op\":" << ns
+                          << ",\"allocs_per_op\":" << allocs << ",\"bytes_per_op\":" << bytes
+                          << ",\"scaling\":";
+
+                if (std::isnan(scaling))
+                {
+                    std::cout << "null}";
+                }
+                else
+                {
+                    std::cout << scaling << "}";
+                }
+            }
+            else
+            {
+                std::cout << name << "," << param << "," << iterations << "," << ns << ","
+                          << allocs << "," << bytes << ",";
+
+                if (!std::isnan(scaling))
+                {
+                    std::cout << scaling;
+                }
+
+                std::cout << std::endl;
+            }
+
+            m_first = false;
+        }
+
+        const Options &m_options;
+        bool m_first = true;
+        std::string m_prev_name;
+        int m_prev_param = 0;
+        double m_prev_ns = 0;
+    };
+
+    void usage()
+    {
+        std::cout << "Usage: bench_geometry [--json] [--filter NAME] [--min-time MS] [--repeats N] [--seed N]\n"
+                  << "\n"
+                  << "  --json          Output a JSON array instead of CSV\n"
+                  << "  --filter NAME   Only run the benchmarks whose name contains NAME\n"
+                  << "  --min-time MS   Minimum duration of each timed run (default: 50)\n"
+                  << "  --repeats N     Number of timed runs, the fastest one is reported (default: 3)\n"
+                  << "  --seed N        Seed for the generated polygons (default: 1)\n";
+    }
+
+    bool parse_options(int argc, char **argv, Options &options)
+    {
+        for (int i = 1; i < argc; i++)
+        {
+            std::string arg = argv[i];
+            bool has_value = i + 1 < argc;
+
+            if (arg == "--json")
+            {
+                options.json = true;
+            }
+            else if (arg == "--filter" && has_value)
+            {
+                options.filter = argv[++i];
+            }
+            else if (arg == "--min-time" && has_value)
+            {
+                options.min_time_ms = atof(argv[++i]);
+            }
+            else if (arg == "--repeats" && has_value)
+            {
+                options.repeats = std::max(1, atoi(argv[++i]));
+            }
+            else if (arg == "--seed" && has_value)
+            {
+                options.seed = strtoull(argv[++i], nullptr, 10);
+            }
+            else
+            {
+                usage();
+                return false;
+            }
+        }
+
+        return true;
+    }
+
+    //
+    // Benchmarks
+    //
+
+    const int POLYGON_SIZES[] = {4, 8, 16, 32, 64, 128, 256};
+    const int OBJECT_COUNTS[] = {100, 1000, 10000, 100000};
+
+    void bench_rotate(Runner &runner)
+    {
+        Point p{10, 20};
+        Point center{5, 5};
+
+        runner.run("rotate", 1, [&]()
+                   {
+                       p.rotate(1.5, center);
+                       s_sink = s_sink + p.x;
+                   });
+    }
+
+    void bench_polygon(Runner &runner, std::mt19937_64 &rng)
+    {
+        World world;
+
+        for (int size : POLYGON_SIZES)
+        {
+            BenchObject obj(world, star(rng, size, 50));
+            obj.set_position({100, 100});
+            obj.set_rotation(30);
+
+            runner.run("points", size, [&]()
+                       { s_sink = s_sink + obj.points().size(); });
+        }
+
+        for (int size : POLYGON_SIZES)
+        {
+            BenchObject obj(world, star(rng, size, 50));
+            obj.set_position({100, 100});
+            obj.set_rotation(30);
+
+            runner.run("lines", size, [&]()
+                       { s_sink = s_sink + obj.lines().size(); });
+        }
+
+        for (int size : POLYGON_SIZES)
+        {
+            BenchObject obj(world, star(rng, size, 50));
+
+            runner.run("scan_lines", size, [&]()
+                       { s_sink = s_sink + obj.scan_lines().size(); });
+        }
+
+        for (int size : POLYGON_SIZES)
+        {
+            BenchObject obj(world, star(rng, size, 50));
+            obj.set_position({100, 100});
+            obj.set_rotation(30);
+            Line line{{0, 150}, {300, 150}};
+
+            runner.run("get_collisions_line", size, [&]()
+                       { s_sink = s_sink + obj.get_collisions(line).second.size(); });
+        }
+
+        for (int size : POLYGON_SIZES)
+        {
+            BenchObject obj(world, star(rng, size, 50));
+            obj.set_position({100, 100});
+
+            // Points inside and outside the polygon, alternated so that both paths are measured
+            Point points[] = {{150, 150}, {105, 105}, {140, 160}, {195, 195}};
+            size_t i = 0;
+
+            runner.run("is_inside", size, [&]()
+                       { s_sink = s_sink + obj.is_inside(points[i++ % 4]); });
+        }
+
+        for (int size : POLYGON_SIZES)
+        {
+            // Two overlapping polygons of the same size
+            BenchObject a(world, star(rng, size, 50));
+            BenchObject b(world, star(rng, size, 50));
+            a.set_position({100, 100});
+            b.set_position({130, 120});
+            b.set_rotation(20);
+
+            runner.run("get_collisions_object", size, [&]()
+                       { s_sink = s_sink + a.get_collisions(b).second.size(); });
+        }
+    }
+
+    // Object::collision() through the spatial index. The world grows with the number of objects so that the density
+    // and the number of nearby objects stay the same: with a working broad phase the cost should not depend on the
+    // number of objects.
+    void bench_world(Runner &runner, std::mt19937_64 &rng)
+    {
+        for (int count : OBJECT_COUNTS)
+        {
+            double side = sqrt((double)count) * 60;
+            World world;
+            std::vector<std::unique_ptr<BenchObject>> objects;
+            objects.reserve(count);
+
+            for (int i = 0; i < count; i++)
+            {
+                auto obj = std::make_unique<BenchObject>(world, star(rng, 8, 12));
+                obj->set_position({(rng() >> 11) * 0x1.0p-53 * side, (rng() >> 11) * 0x1.0p-53 * side});
+                obj->set_rotation((rng() >> 11) * 0x1.0p-53 * 360);
+                objects.push_back(std::move(obj));
+            }
+
+            size_t i = 0;
+
+            runner.run("collision", count, [&]()
+                       {
+                           s_sink = s_sink + objects[i++ % objects.size()]->collision();
+
+                           // Keep the contact list from growing without bound
+                           world.clear_contacts();
+                       });
+        }
+    }
+}
+
+int main(int argc, char **argv)
+{
+    Options options;
+
+    if (!parse_options(argc, argv, options))
+    {
+        return 1;
+    }
+
+    std::mt19937_64 rng(options.seed);
+
+    {
+        Runner runner(options);
+        bench_rotate(runner);
+        bench_polygon(runner, rng);
+        bench_world(runner, rng);
+    }
+
+    return 0;
+}
@@ -0,0 +1,386 @@
+#include "../grid.hh"
+#include "../planner.hh"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+
+// Runs the scenarios of the MovingAI grid pathfinding benchmarks (https://movingai.com/benchmarks/grids.html)
+// and reports the latency and the amount of work done per query along with the quality of the paths.
+
+namespace
+{
+    using Clock = std::chrono::steady_clock;
+
+    struct Options
+    {
+        bool json = false;
+        std::string map;
+        std::string queries;
+        size_t limit = 0;
+        std::vector<GridPlanner::Algorithm> planners;
+        std::vector<std::string> scenarios;
+    };
+
+    // One line of a .scen file
+    struct Query
+    {
+        int bucket;
+        std::string map;
+        GridCell start;
+        GridCell goal;
+        double optimal;
+    };
+
+    struct Result
+    {
+        double us;
+        bool found;
+        double length;
+        double optimal;
+        GridPlanner::Stats stats;
+    };
+
+    std::vector<Query> load_scenario(const std::string &filename)
+    {
+        std::ifstream file(filename);
+
+        if (!file)
+        {
+            throw Error("Could not open " + filename);
+        }
+
+        std::string line;
+        std::vector<Query> queries;
+
+        if (!std::getline(file, line) || line.compare(0, 7, "version") != 0)
+        {
+            throw Error(filename + " is not a scenario file");
+        }
+
+        while (std::getline(file, line))
+        {
+            std::istringstream in(line);
+            Query q;
+            int width, height;
+
+            if (in >> q.bucket >> q.map >> width >> height >> q.start.x >> q.start.y >> q.goal.x >> q.goal.y >> q.optimal)
+            {
+                queries.push_back(q);
+            }
+            else if (line.find_first_not_of(" \t\r") != std::string::npos)
+            {
+                throw Error("Invalid line in " + filename + ": " + line);
+            }
+        }
+
+        return queries;
+    }
+
+    // The map names in the scenario files are relative to wherever the benchmark was generated. The map is looked
+    // for next to the scenario file, first with the full relative path and then with only the file name.
+    std::string find_map(const std::string &scenario, const std::string &map)
+    {
+        namespace fs = std::filesystem;
+        auto dir = fs::path(scenario).parent_path();
+
+        for (const auto &candidate : {dir / map, dir / fs::path(map).filename(), fs::path(map)})
+        {
+            if (fs::exists(candidate))
+            {
+                return candidate.string();
+            }
+        }
+
+        throw Error("Could not find map " + map + " for " + scenario);
+    }
+
+    // Map and scenario names are file paths, on Windows they are full of backslashes
+    std::string json_string(const std::string &str)
+    {
+        std::string out = "\"";
+
+        for (char c : str)
+        {
+            if (c == '"' || c == '\\')
+            {
+                out += '\\';
+                out += c;
+            }
+            else if ((unsigned char)c < 0x20)
+            {
+                char buf[8];
+                snprintf(buf, sizeof(buf), "\\u%04x", c);
+                out += buf;
+            }
+            else
+            {
+                out += c;
+            }
+        }
+
+        return out + '"';
+    }
+
+    void report(const Options &options, const std::string &scenario, const std::string &map, const char *planner,
+                const std::vector<Result> &results, bool first)
+    {
+        std::vector<double> latencies;
+        size_t failed = 0;
+        double expanded = 0;
+        double pushes = 0;
+        double pops = 0;
+        double line_of_sight = 0;
+        size_t memory = 0;
+        double total_us = 0;
+
+        for (const auto &r : results)
+        {
+            latencies.push_back(r.us);
+            total_us += r.us;
+            failed += !r.found;
+            expanded += r.stats.expanded;
+            pushes += r.stats.heap_pushes;
+            pops += r.stats.heap_pops;
+            line_of_sight += r.stats.line_of_sight;
+            memory = std::max(memory, r.stats.memory);
+        }
+
+        std::sort(latencies.begin(), latencies.end());
+        size_t n = std::max<size_t>(1, results.size());
+        double p50 = percentile(latencies, 0.5);
+        double p90 = percentile(latencies, 0.9);
+        double p99 = percentile(latencies, 0.99);
+
+        double subopt_mean = 0;
+        double subopt_max = 0;
+        size_t solved = 0;
+        size_t shorter = 0;
+
+        for (const auto &r : results)
+        {
+            if (r.found && r.length > 0)
+            {
+                double ratio = r.length / r.optimal;
+                subopt_mean += ratio;
+                subopt_max = std::max(subopt_max, ratio);
+                solved++;
+
+                // The optimal lengths are for 8-connected moves and rounded in the files. A* finding anything
+                // shorter is a bug, the any-angle planners should do it whenever the path isn't a straight line.
+                shorter += r.length < r.optimal - 1e-3;
+            }
+        }
+
+        subopt_mean = solved ? subopt_mean / solved : 0;
+
+        if (options.json)
+        {
+            std::cout << (first ? "" : ",\n")
+                      << "{\"scenario\":" << json_string(scenario) << ",\"map\":" << json_string(map)
+                      << ",\"planner\":\"" << planner << "\""
+                      << ",\"queries\":" << results.size() << ",\"failed\":" << failed
+                      << ",\"p50_us\":" << p50 << ",\"p90_us\":" << p90
+                      << ",\"p99_us\":" << p99 << ",\"max_us\":" << (latencies.empty() ? 0 : latencies.back())
+                      << ",\"mean_us\":" << total_us / n << ",\"expanded\":" << expanded / n
+                      << ",\"heap_pushes\":" << pushes / n << ",\"heap_pops\":" << pops / n
+                      << ",\"line_of_sight\":" << line_of_sight / n
+                      << ",\"memory_bytes\":" << memory << ",\"suboptimality_mean\":" << subopt_mean
+                      << ",\"suboptimality_max\":" << subopt_max << ",\"shorter_than_optimal\":" << shorter << "}";
+        }
+        else
+        {
+            std::cout << scenario << "," << map << "," << planner << "," << results.size() << "," << failed << ","
+                      << p50 << "," << p90 << "," << p99 << ","
+                      << (latencies.empty() ? 0 : latencies.back()) << "," << total_us / n << ","
+                      << expanded / n << "," << pushes / n << "," << pops / n << "," << line_of_sight / n << ","
+                      << memory << ","
+                      << subopt_mean << "," << subopt_max << "," << shorter << std::endl;
+        }
+    }
+
+    void usage()
+    {
+        std::cout << "Usage: bench_paths [OPTIONS] SCEN...\n"
+                  << "\n"
+                  << "  --json          Output a JSON array instead of CSV\n"
+                  << "  --map FILE      Use this map for all scenarios instead of the one named in the file\n"
+                  << "  --limit N       Only run the first N queries of each scenario file\n"
+                  << "  --planner NAME  The planner to run: astar (default), theta or lazy-theta. Can be given\n"
+                  << "                  more than once to compare them.\n"
+                  << "  --queries FILE  Write the results of every query into a CSV file\n";
+    }
+
+    bool parse_options(int argc, char **argv, Options &options)
+    {
+        for (int i = 1; i < argc; i++)
+        {
+            std::string arg = argv[i];
+            bool has_value = i + 1 < argc;
+
+            if (arg == "--json")
+            {
+                options.json = true;
+            }
+            else if (arg == "--map" && has_value)
+            {
+                options.map = argv[++i];
+            }
+            else if (arg == "--limit" && has_value)
+            {
+                options.limit = strtoull(argv[++i], nullptr, 10);
+            }
+            else if (arg == "--queries" && has_value)
+            {
+                options.queries = argv[++i];
+            }
+            else if (arg == "--planner" && has_value)
+            {
+                options.planners.push_back(GridPlanner::parse_algorithm(argv[++i]));
+            }
+            else if (arg.compare(0, 2, "--") == 0)
+            {
+                usage();
+                return false;
+            }
+            else
+            {
+                options.scenarios.push_back(arg);
+            }
+        }
+
+        if (options.scenarios.empty())
+        {
+            usage();
+            return false;
+        }
+
+        if (options.planners.empty())
+        {
+            options.planners.push_back(GridPlanner::Algorithm::A_STAR);
+        }
+
+        return true;
+    }
+}
+
+int main(int argc, char **argv)
+{
+    Options options;
+
+    try
+    {
+        if (!parse_options(argc, argv, options))
+        {
+            return 1;
+        }
+
+        // Grids are shared between the scenarios that use the same map, and so are the planners for each map
+        std::map<std::string, std::unique_ptr<OccupancyGrid>> grids;
+        std::map<std::pair<std::string, GridPlanner::Algorithm>, std::unique_ptr<GridPlanner>> planners;
+        std::ofstream queries_out;
+
+        if (!options.queries.empty())
+        {
+            queries_out.open(options.queries);
+            queries_out << "scenario,planner,query,bucket,us,found,length,optimal,expanded,heap_pushes,heap_pops,"
+                        << "line_of_sight,memory_bytes\n";
+        }
+
+        if (options.json)
+        {
+            std::cout << "[" << std::endl;
+        }
+        else
+        {
+            std::cout << "scenario,map,planner,queries,failed,p50_us,p90_us,p99_us,max_us,mean_us,expanded,heap_pushes,"
+                      << "heap_pops,line_of_sight,memory_bytes,suboptimality_mean,suboptimality_max,shorter_than_optimal"
+                      << std::endl;
+        }
+
+        bool first = true;
+
+        for (const auto &scenario : options.scenarios)
+        {
+            auto queries = load_scenario(scenario);
+
+            if (options.limit && queries.size() > options.limit)
+            {
+                queries.resize(options.limit);
+            }
+
+            for (auto algorithm : options.planners)
+            {
+                const char *name = GridPlanner::algorithm_name(algorithm);
+                std::vector<Result> results;
+                std::vector<GridCell> path;
+                std::string map_file;
+
+                for (size_t i = 0; i < queries.size(); i++)
+                {
+                    const auto &q = queries[i];
+                    auto file = options.map.empty() ? find_map(scenario, q.map) : options.map;
+                    auto &grid = grids[file];
+                    auto &planner = planners[{file, algorithm}];
+
+                    if (!grid)
+                    {
+                        grid = std::make_unique<OccupancyGrid>(OccupancyGrid::load_map(file));
+                    }
+
+                    if (!planner)
+                    {
+                        planner = std::make_unique<GridPlanner>(*grid, algorithm);
+                    }
+
+                    map_file = file;
+
+                    auto start = Clock::now();
+                    bool found = planner->find_path(q.start, q.goal, path);
+                    auto end = Clock::now();
+
+                    Result r;
+                    r.us = std::chrono::duration<double, std::micro>(end - start).count();
+                    r.found = found;
+                    r.length = found ? GridPlanner::length(path) : 0;
+                    r.optimal = q.optimal;
+                    r.stats = planner->stats();
+                    results.push_back(r);
+
+                    if (queries_out.is_open())
+                    {
+                        queries_out << scenario << ',' << name << ',' << i << ',' << q.bucket << ',' << r.us << ','
+                                    << r.found << ',' << r.length << ',' << q.optimal << ',' << r.stats.expanded << ','
+                                    << r.stats.heap_pushes << ',' << r.stats.heap_pops << ','
+                                    << r.stats.line_of_sight << ',' << r.stats.memory << '\n';
+                    }
+                }
+
+                report(options, scenario, map_file, name, results, first);
+                first = false;
+            }
+        }
+
+        if (options.json)
+        {
+            std::cout << std::endl
+                      << "]" << std::endl;
+        }
+    }
+    catch (const Error &e)
+    {
+        std::cerr << e.what() << std::endl;
+        return 1;
+    }
+
+    return 0;
+}
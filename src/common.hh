@@ -4,9 +4,12 @@
 #include <SDL.h>
 #include <SDL_ttf.h>
 
+#include <algorithm>
+#include <cmath>
 #include <stdexcept>
 #include <cstdint>
 #include <string>
+#include <vector>
 
 struct Error : public std::runtime_error
 {
@@ -15,3 +18,18 @@ struct Error : public std::runtime_error
     {
     }
 };
+
+// The nearest-rank percentile of values sorted in ascending order, p is between 0 and 1: the smallest value that
+// at least p of the values are less than or equal to. An empty vector gives a default-constructed value.
+template <class T>
+T percentile(const std::vector<T> &sorted, double p)
+{
+    if (sorted.empty())
+    {
+        return T{};
+    }
+
+    // p * size is often a whole number that came out slightly too large, 0.07 * 100 for example
+    double rank = std::ceil(p * sorted.size() * (1 - 1e-12));
+    return sorted[std::min(sorted.size(), (size_t)std::max(1.0, rank)) - 1];
+}
@@ -0,0 +1,299 @@
+#include <tuple>
+#include <cstdint>
+
+#include "entities.hh"
+
+using namespace std;
+
+// static
+std::unique_ptr<Wall> Wall::create(World &world, SDL_Renderer *renderer, std::vector<Point> outline)
+{
+    return std::unique_ptr<Wall>(new Wall(world, renderer, outline));
+}
+
+Wall::Wall(World &world, SDL_Renderer *renderer, std::vector<Point> outline)
+    : Object(world, outline, Object::Mobility::STATIC), m_polygon(this, renderer)
+{
+    m_polygon.set_fill(COLOR_GRAY);
+    m_polygon.set_outline(COLOR_GREEN);
+    m_polygon.redraw();
+}
+
+void Wall::tick(int steps)
+{
+}
+
+void Wall::state_changed(Object::ChangeType type)
+{
+}
+
+void Wall::render(SDL_Renderer *renderer, const Camera &camera) const
+{
+    m_polygon.render(renderer, camera);
+}
+
+void Wall::append(Batch &batch, const Camera &camera) const
+{
+    m_polygon.append(batch, camera);
+}
+
+Navigator::Navigator(World &world, SDL_Renderer *renderer, std::vector<Point> outline)
+    : Object(world, outline), EventListener(world.events()), m_polygon(this, renderer)
+{
+    m_polygon.set_fill(COLOR_GREEN);
+    m_polygon.set_outline(COLOR_BLACK);
+    m_polygon.redraw();
+}
+
+Navigator::Navigator(World &world, SDL_Renderer *renderer)
+    : Navigator(world, renderer, {
+                              {0, 0},
+                              {50, 0},
+                              {50, 50},
+                              {0, 50},
+                          })
+{
+}
+
+// static
+std::unique_ptr<Navigator> Navigator::create(World &world, SDL_Renderer *renderer)
+{
+    return std::unique_ptr<Navigator>(new Navigator(world, renderer));
+}
+
+void Navigator::tick(int steps)
+{
+    if (m_goal_state == GoalState::MOVING)
+    {
+        steer(steps);
+    }
+
+    if (m_motion == Point{0, 0} && m_rotation == 0)
+    {
+        // Nothing to do until we're told to move or something moves near us
+        sleep();
+        return;
+    }
+
+    auto motion = m_motion * steps;
+    auto rotation_step = m_rotation * steps;
+
+    set_position(position() + motion);
+    set_rotation(rotation() + rotation_step);
+
+    if (collision())
+    {
+        set_position(position() - motion);
+        set_rotation(rotation() - rotation_step);
+        m_motion.x = 0;
+        m_motion.y = 0;
+        m_rotation = 0;
+
+        if (m_goal_state == GoalState::MOVING)
+        {
+            m_goal_state = GoalState::BLOCKED;
+        }
+    }
+}
+
+void Navigator::set_goal(Point goal)
+{
+    m_goal = goal;
+    m_goal_state = GoalState::MOVING;
+    wake();
+}
+
+Navigator::GoalState Navigator::goal_state() const
+{
+    return m_goal_state;
+}
+
+const Point &Navigator::goal() const
+{
+    return m_goal;
+}
+
+void Navigator::steer(int steps)
+{
+    const auto &rect = world_rect();
+    auto d = m_goal - (rect.first + rect.second) * 0.5;
+    double dist = sqrt(d.dot(d));
+
+    if (dist < 0.5)
+    {
+        m_goal_state = GoalState::REACHED;
+        m_motion = {0, 0};
+    }
+    else
+    {
+        // Slow down near the goal instead of overshooting it
+        m_motion = d * (std::min<double>(steps, dist) / (dist * steps));
+    }
+}
+
+Color Navigator::fill_color() const
+{
+    if (!is_active())
+    {
+        return COLOR_GRAY;
+    }
+    else if (!is_collision_enabled())
+    {
+        return COLOR_MAGENTA;
+    }
+    else if (m_selected)
+    {
+        return COLOR_BLUE;
+    }
+    else
+    {
+        return COLOR_GREEN;
+    }
+}
+
+Color Navigator::outline_color() const
+{
+    if (m_hover || m_selected)
+    {
+        return COLOR_RED;
+    }
+    else
+    {
+        return COLOR_BLACK;
+    }
+}
+
+void Navigator::state_changed(Object::ChangeType type)
+{
+    switch (type)
+    {
+    case Object::ChangeType::COLLISION:
+    case Object::ChangeType::ACTIVE:
+        m_polygon.set_fill(fill_color());
+        m_polygon.set_outline(outline_color());
+        m_polygon.redraw();
+        break;
+    }
+}
+
+void Navigator::render(SDL_Renderer *renderer, const Camera &camera) const
+{
+    m_polygon.render(renderer, camera);
+}
+
+void Navigator::append(Batch &batch, const Camera &camera) const
+{
+    m_polygon.append(batch, camera);
+}
+
+void Navigator::hover_changed(bool hover)
+{
+    m_hover = hover;
+    m_polygon.set_outline(outline_color());
+    m_polygon.redraw();
+}
+
+void Navigator::on_key_up(const SDL_Event &event)
+{
+    switch (event.key.keysym.sym)
+    {
+    case SDLK_a:
+    case SDLK_d:
+        m_motion.x = 0;
+        break;
+
+    case SDLK_w:
+    case SDLK_s:
+        m_motion.y = 0;
+        break;
+
+    case SDLK_q:
+    case SDLK_e:
+        m_rotation = 0;
+        break;
+    }
+}
+
+void Navigator::on_key_down(const SDL_Event &event)
+{
+    double speed = (world().events().modifiers() & KMOD_SHIFT) ? 0.1 : 1.0;
+
+    switch (event.key.keysym.sym)
+    {
+    case SDLK_a:
+        m_motion.x = -speed;
+        break;
+
+    case SDLK_d:
+        m_motion.x = speed;
+        break;
+
+    case SDLK_w:
+        m_motion.y = -speed;
+        break;
+
+    case SDLK_s:
+        m_motion.y = speed;
+        break;
+
+    case SDLK_q:
+        m_rotation = speed;
+        break;
+
+    case SDLK_e:
+        m_rotation = -speed;
+        break;
+
+    default:
+        return;
+    }
+
+    // Moving by hand cancels the goal
+    m_goal_state = GoalState::NONE;
+    wake();
+}
+
+void Navigator::set_selected(bool selected)
+{
+    m_selected = selected;
+    m_polygon.set_fill(fill_color());
+    m_polygon.set_outline(outline_color());
+    m_polygon.redraw();
+
+    if (selected)
+    {
+        listen<&Navigator::on_key_down>(SDL_KEYDOWN);
+        listen<&Navigator::on_key_up>(SDL_KEYUP);
+    }
+    else
+    {
+        stop_listening(SDL_KEYDOWN);
+        stop_listening(SDL_KEYUP);
+    }
+}
+
+bool Navigator::is_selected() const
+{
+    return m_selected;
+}
+
+void create_entities(World &world, SDL_Renderer *renderer, const SceneView &scene,
+                     std::vector<std::unique_ptr<Wall>> &walls, std::vector<std::unique_ptr<Navigator>> &navigators)
+{
+    for (uint32_t i = 0; i < scene.wall_count; i++)
+    {
+        auto [begin, end] = scene.wall(i);
+        walls.push_back(Wall::create(world, renderer, std::vector<Point>(begin, end)));
+    }
+
+    for (uint32_t i = 0; i < scene.agent_count; i++)
+    {
+        const auto &agent = scene.agents[i];
+        auto navigator = Navigator::create(world, renderer);
+        navigator->set_position(agent.position);
+        navigator->set_rotation(agent.rotation);
+        navigator->set_active(agent.flags & AgentRecord::ACTIVE);
+        navigator->set_collision_enabled(agent.flags & AgentRecord::COLLISION);
+        navigators.push_back(std::move(navigator));
+    }
+}
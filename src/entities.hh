@@ -0,0 +1,95 @@
+#pragma once
+
+#include "common.hh"
+#include "objects.hh"
+#include "events.hh"
+#include "graphics.hh"
+#include "pool.hh"
+#include "scene.hh"
+#include "world.hh"
+
+#include <memory>
+
+// The renderer of the walls and navigators is only used when they are drawn with render(). Worlds that are
+// simulated without ever being drawn can create them with a null renderer and don't need SDL to be initialized.
+class Wall : public Object, public Renderable, public Pooled<Wall>
+{
+public:
+    static std::unique_ptr<Wall> create(World &world, SDL_Renderer *renderer, std::vector<Point> outline);
+
+    ~Wall() = default;
+
+    void tick(int steps) override;
+
+    void state_changed(Object::ChangeType type) override;
+
+    void render(SDL_Renderer *renderer, const Camera &camera) const override;
+
+    void append(Batch &batch, const Camera &camera) const override;
+
+private:
+    Wall(World &world, SDL_Renderer *renderer, std::vector<Point> outline);
+    Polygon m_polygon;
+};
+
+class Navigator : public Object, public EventListener<Navigator>, public Renderable, public Pooled<Navigator>
+{
+public:
+    enum class GoalState
+    {
+        NONE,    // No goal was given or it was cancelled by moving by hand
+        MOVING,  // On the way to the goal
+        REACHED, // The center of the navigator is at the goal
+        BLOCKED, // Stopped by a collision before reaching the goal
+    };
+
+    static std::unique_ptr<Navigator> create(World &world, SDL_Renderer *renderer);
+
+    void tick(int steps) override;
+
+    void state_changed(Object::ChangeType type) override;
+
+    void hover_changed(bool hover) override;
+
+    void render(SDL_Renderer *renderer, const Camera &camera) const override;
+
+    void append(Batch &batch, const Camera &camera) const override;
+
+    void set_selected(bool is_selected);
+
+    bool is_selected() const;
+
+    // Moves the navigator in a straight line until its center reaches the goal or it hits something
+    void set_goal(Point goal);
+
+    GoalState goal_state() const;
+
+    // The last goal given with set_goal()
+    const Point &goal() const;
+
+private:
+    Navigator(World &world, SDL_Renderer *renderer);
+    Navigator(World &world, SDL_Renderer *renderer, std::vector<Point> outline);
+
+    void on_key_down(const SDL_Event &event);
+    void on_key_up(const SDL_Event &event);
+
+    Color fill_color() const;
+
+    Color outline_color() const;
+
+    // Points the motion towards the goal
+    void steer(int steps);
+
+    Polygon m_polygon;
+    Point m_motion{0, 0};
+    double m_rotation = 0;
+    Point m_goal;
+    GoalState m_goal_state = GoalState::NONE;
+    bool m_selected = false;
+    bool m_hover = false;
+};
+
+// Creates the walls and navigators of a scene in the world
+void create_entities(World &world, SDL_Renderer *renderer, const SceneView &scene,
+                     std::vector<std::unique_ptr<Wall>> &walls, std::vector<std::unique_ptr<Navigator>> &navigators);
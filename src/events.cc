@@ -1,33 +1,222 @@
 #include "events.hh"
 
-namespace
+void EventGenerator::handle_event(const SDL_Event &event, uint16_t modifiers)
 {
-    EventGenerator s_event_generator;
+    dispatch(event, modifiers, Delivery::ALL);
 }
 
-// static
-void EventGenerator::handle_event(const SDL_Event &event)
+void EventGenerator::queue(const SDL_Event &event, uint16_t modifiers)
 {
-    for (auto [key, func] : s_event_generator.m_listeners[event.type])
+    bool mergeable = event.type == SDL_MOUSEMOTION || event.type == SDL_MOUSEWHEEL;
+
+    if (!mergeable)
+    {
+        flush();
+        dispatch(event, modifiers, Delivery::ALL);
+        return;
+    }
+
+    dispatch(event, modifiers, Delivery::EVERY_SAMPLE);
+
+    if (!merge(event, modifiers))
     {
-        func(event);
+        flush();
+        m_pending = event;
+        m_pending_modifiers = modifiers;
+        m_has_pending = true;
     }
 }
 
-void EventGenerator::add(void *instance, uint32_t event, EventHandler handler)
+void EventGenerator::flush()
 {
-    s_event_generator.m_listeners[event].emplace(instance, handler);
+    if (m_has_pending)
+    {
+        m_has_pending = false;
+        dispatch(m_pending, m_pending_modifiers, Delivery::MERGED);
+    }
+}
+
+bool EventGenerator::merge(const SDL_Event &event, uint16_t modifiers)
+{
+    if (!m_has_pending || m_pending.type != event.type || m_pending_modifiers != modifiers)
+    {
+        return false;
+    }
+
+    if (event.type == SDL_MOUSEMOTION)
+    {
+        auto &m = m_pending.motion;
+
+        if (m.windowID != event.motion.windowID || m.which != event.motion.which)
+        {
+            return false;
+        }
+
+        // The latest position and button state with the relative motion of all the events
+        int xrel = m.xrel + event.motion.xrel;
+        int yrel = m.yrel + event.motion.yrel;
+        m = event.motion;
+        m.xrel = xrel;
+        m.yrel = yrel;
+    }
+    else
+    {
+        auto &w = m_pending.wheel;
+
+        if (w.windowID != event.wheel.windowID || w.which != event.wheel.which || w.direction != event.wheel.direction)
+        {
+            return false;
+        }
+
+        w.x += event.wheel.x;
+        w.y += event.wheel.y;
+        w.preciseX += event.wheel.preciseX;
+        w.preciseY += event.wheel.preciseY;
+        w.timestamp = event.wheel.timestamp;
+    }
+
+    return true;
+}
+
+void EventGenerator::dispatch(const SDL_Event &event, uint16_t modifiers, Delivery delivery)
+{
+    if (event.type >= m_slots.size() || m_slots[event.type] == 0)
+    {
+        return;
+    }
+
+    m_modifiers = modifiers;
+    uint16_t first = m_slots[event.type] + (delivery == Delivery::EVERY_SAMPLE);
+    uint16_t last = m_slots[event.type] + (delivery != Delivery::MERGED);
+
+    // The handlers can add and remove handlers, only the ones that existed before the dispatch are called.
+    // They are accessed by index as adding can reallocate the arrays.
+    ++m_dispatching;
+
+    for (uint16_t slot = first; slot <= last; slot++)
+    {
+        size_t count = m_handlers[slot].handlers.size();
+
+        for (size_t i = 0; i < count; i++)
+        {
+            EventHandler h = m_handlers[slot].handlers[i];
+
+            if (h.func)
+            {
+                h.func(h.instance, event);
+            }
+        }
+    }
+
+    if (--m_dispatching == 0)
+    {
+        sweep();
+    }
+}
+
+uint16_t EventGenerator::modifiers() const
+{
+    return m_modifiers;
+}
+
+void EventGenerator::add(uint32_t event, EventHandler handler, bool every_sample)
+{
+    assert(event < m_slots.size());
+
+    if (m_slots[event] == 0)
+    {
+        assert(m_handlers.size() < 0xffff);
+        m_slots[event] = m_handlers.size();
+        m_handlers.resize(m_handlers.size() + 2);
+    }
+
+    auto &h = m_handlers[m_slots[event] + every_sample];
+    auto [it, inserted] = h.index.emplace(handler.instance, h.handlers.size());
+
+    if (inserted)
+    {
+        h.handlers.push_back(handler);
+    }
+    else
+    {
+        h.handlers[it->second] = handler;
+    }
 }
 
 void EventGenerator::remove(void *instance)
 {
-    for (auto &[event, handlers] : s_event_generator.m_listeners)
+    for (size_t i = 1; i < m_handlers.size(); i++)
     {
-        handlers.erase(instance);
+        remove(m_handlers[i], instance);
     }
 }
 
 void EventGenerator::remove(void *instance, uint32_t event)
 {
-    s_event_generator.m_listeners[event].erase(instance);
+    if (event < m_slots.size() && m_slots[event] != 0)
+    {
+        remove(m_handlers[m_slots[event]], instance);
+        remove(m_handlers[m_slots[event] + 1], instance);
+    }
+}
+
+void EventGenerator::remove(Handlers &h, void *instance)
+{
+    auto it = h.index.find(instance);
+
+    if (it == h.index.end())
+    {
+        return;
+    }
+
+    uint32_t pos = it->second;
+    h.index.erase(it);
+
+    if (m_dispatching)
+    {
+        // The array is being iterated, leave a hole that's removed after the dispatch
+        h.handlers[pos].func = nullptr;
+        h.has_removed = true;
+    }
+    else
+    {
+        if (pos != h.handlers.size() - 1)
+        {
+            h.handlers[pos] = h.handlers.back();
+
+            if (h.handlers[pos].func)
+            {
+                h.index[h.handlers[pos].instance] = pos;
+            }
+        }
+
+        h.handlers.pop_back();
+    }
+}
+
+void EventGenerator::sweep()
+{
+    for (size_t i = 1; i < m_handlers.size(); i++)
+    {
+        auto &h = m_handlers[i];
+
+        if (!h.has_removed)
+        {
+            continue;
+        }
+
+        uint32_t out = 0;
+
+        for (const auto &handler : h.handlers)
+        {
+            if (handler.func)
+            {
+                h.index[handler.instance] = out;
+                h.handlers[out++] = handler;
+            }
+        }
+
+        h.handlers.resize(out);
+        h.has_removed = false;
+    }
 }
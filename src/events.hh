@@ -2,49 +2,128 @@
 
 #include "common.hh"
 
-#include <map>
-#include <set>
 #include <cassert>
-#include <functional>
+#include <unordered_map>
+#include <vector>
 
-using EventHandler = std::function<void(const SDL_Event &)>;
+// A non-owning reference to a handler function of a listener. The function gets the instance as its first
+// argument.
+struct EventHandler
+{
+    void *instance;
+    void (*func)(void *instance, const SDL_Event &event);
+};
 
+// Dispatches events to the listeners. Every World has its own.
 class EventGenerator
 {
 public:
-    static void handle_event(const SDL_Event &event);
+    EventGenerator() = default;
+    EventGenerator(const EventGenerator &) = delete;
+    EventGenerator &operator=(const EventGenerator &) = delete;
+
+    // Dispatch an event with the given keyboard modifier state right away
+    void handle_event(const SDL_Event &event, uint16_t modifiers);
+
+    // Queues an event for dispatch. Consecutive mouse motion and wheel events are merged into one that's
+    // dispatched when a different event is queued or flush() is called. Handlers that want every sample get
+    // the original events right away.
+    void queue(const SDL_Event &event, uint16_t modifiers);
 
-    static void add(void *instance, uint32_t event, EventHandler handler);
+    // Dispatches the merged event, if any. Called once per frame after all the events have been queued.
+    void flush();
 
-    static void remove(void *instance);
+    // The keyboard modifier state at the time the event being handled was generated. Handlers should use this
+    // instead of SDL_GetModState() so that recorded events replay the same way.
+    uint16_t modifiers() const;
 
-    static void remove(void *instance, uint32_t event);
+    // Adds a handler for the event type, replacing any previous handler the instance had for it. Handlers
+    // added while an event is being dispatched are called starting from the next event. A handler that wants
+    // every sample gets all the queued mouse motion and wheel events instead of the merged ones, an instance
+    // can have one handler of both kinds for the same event.
+    void add(uint32_t event, EventHandler handler, bool every_sample = false);
+
+    // Removes the handlers of the instance. Handlers that are removed while an event is being dispatched are
+    // not called anymore, even for the current event.
+    void remove(void *instance);
+
+    void remove(void *instance, uint32_t event);
 
 private:
-    std::map<uint32_t, std::map<void *, EventHandler>> m_listeners;
+    struct Handlers
+    {
+        std::vector<EventHandler> handlers;
+
+        // Position of each instance in the handlers
+        std::unordered_map<void *, uint32_t> index;
+
+        // Handlers that were removed during dispatch are left in place with a null function
+        bool has_removed = false;
+    };
+
+    enum class Delivery
+    {
+        ALL,
+        EVERY_SAMPLE,
+        MERGED,
+    };
+
+    void dispatch(const SDL_Event &event, uint16_t modifiers, Delivery delivery);
+
+    // Merges the event into the pending one if both are motion or wheel events from the same source
+    bool merge(const SDL_Event &event, uint16_t modifiers);
+
+    void remove(Handlers &handlers, void *instance);
+
+    // Drops the handlers that were removed during dispatch
+    void sweep();
+
+    // Every event type has a slot in the table, zero means there are no handlers for it. The handlers that
+    // want every sample are in the next slot.
+    std::vector<uint16_t> m_slots = std::vector<uint16_t>(0x10000, 0);
+    std::vector<Handlers> m_handlers = std::vector<Handlers>(1);
+    int m_dispatching = 0;
+    uint16_t m_modifiers = 0;
+
+    // The merged event waiting to be dispatched
+    SDL_Event m_pending;
+    uint16_t m_pending_modifiers = 0;
+    bool m_has_pending = false;
 };
 
+// The generator must outlive the listener
 template <class Derived>
 class EventListener
 {
 public:
-    virtual ~EventListener()
+    EventListener(EventGenerator &events)
+        : m_events(events)
     {
-        EventGenerator::remove(this);
     }
 
-    void listen(uint32_t event, void (Derived::*fnc)(const SDL_Event &))
+    virtual ~EventListener()
     {
-        EventHandler handler = [=](const auto &event)
-        {
-            (static_cast<Derived *>(this)->*fnc)(event);
-        };
+        m_events.remove(this);
+    }
 
-        EventGenerator::add(this, event, handler);
+    // Listen to an event. Queued mouse motion and wheel events are merged unless every_sample is set.
+    template <void (Derived::*fnc)(const SDL_Event &)>
+    void listen(uint32_t event, bool every_sample = false)
+    {
+        m_events.add(event, {static_cast<EventListener *>(this), &call<fnc>}, every_sample);
     }
 
     void stop_listening(uint32_t event)
     {
-        EventGenerator::remove(this, event);
+        m_events.remove(static_cast<EventListener *>(this), event);
     }
-};
\ No newline at end of file
+
+private:
+    EventGenerator &m_events;
+
+    template <void (Derived::*fnc)(const SDL_Event &)>
+    static void call(void *instance, const SDL_Event &event)
+    {
+        (static_cast<Derived *>(static_cast<EventListener *>(instance))->*fnc)(event);
+    }
+};
@@ -0,0 +1,324 @@
+#include "generator.hh"
+#include "spatial.hh"
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <random>
+#include <sstream>
+
+namespace
+{
+    // The size of the Navigator outline
+    constexpr double AGENT_SIZE = 50;
+
+    // The thickness of maze and corridor walls
+    constexpr double WALL_THICKNESS = 4;
+
+    constexpr double PI = 3.14159265358979323846;
+
+    std::vector<Point> rectangle(double x0, double y0, double x1, double y1)
+    {
+        return {{x0, y0}, {x1, y0}, {x1, y1}, {x0, y1}};
+    }
+
+    void random_walls(Random &rng, const GeneratorOptions &options, std::vector<std::vector<Point>> &walls)
+    {
+        for (int i = 0; i < options.walls; i++)
+        {
+            double radius = rng.uniform(20, 120);
+            Point center{rng.uniform(radius, std::max(radius, options.width - radius)),
+                         rng.uniform(radius, std::max(radius, options.height - radius))};
+            walls.push_back(star_polygon(rng, center, radius, i % 2 == 0));
+        }
+    }
+
+    void maze_walls(Random &rng, const GeneratorOptions &options, std::vector<std::vector<Point>> &walls)
+    {
+        int cols = std::max(1, (int)(options.width / options.cell));
+        int rows = std::max(1, (int)(options.height / options.cell));
+
+        // The walls on the top and the left side of each cell, the bottom and right edges are handled separately
+        std::vector<bool> top(cols * rows, true);
+        std::vector<bool> left(cols * rows, true);
+        std::vector<bool> visited(cols * rows, false);
+        std::vector<int> stack{0};
+        visited[0] = true;
+
+        // Randomized depth-first search
+        while (!stack.empty())
+        {
+            int cell = stack.back();
+            int x = cell % cols;
+            int y = cell / cols;
+            int neighbors[4];
+            int count = 0;
+
+            if (x > 0 && !visited[cell - 1])
+                neighbors[count++] = cell - 1;
+            if (x < cols - 1 && !visited[cell + 1])
+                neighbors[count++] = cell + 1;
+            if (y > 0 && !visited[cell - cols])
+                neighbors[count++] = cell - cols;
+            if (y < rows - 1 && !visited[cell + cols])
+                neighbors[count++] = cell + cols;
+
+            if (count == 0)
+            {
+                stack.pop_back();
+                continue;
+            }
+
+            int next = neighbors[rng.integer(0, count - 1)];
+
+            if (next == cell - 1)
+                left[cell] = false;
+            else if (next == cell + 1)
+                left[next] = false;
+            else if (next == cell - cols)
+                top[cell] = false;
+            else
+                top[next] = false;
+
+            visited[next] = true;
+            stack.push_back(next);
+        }
+
+        double c = options.cell;
+        double t = WALL_THICKNESS;
+
+        // Merge consecutive wall segments into one long wall to keep the number of objects down
+        for (int y = 0; y <= rows; y++)
+        {
+            for (int x = 0; x < cols;)
+            {
+                auto has = [&](int xi)
+                { return y == rows || top[y * cols + xi]; };
+
+                if (!has(x))
+                {
+                    x++;
+                    continue;
+                }
+
+                int start = x;
+
+                while (x < cols && has(x))
+                {
+                    x++;
+                }
+
+                walls.push_back(rectangle(start * c, y * c, x * c + t, y * c + t));
+            }
+        }
+
+        for (int x = 0; x <= cols; x++)
+        {
+            for (int y = 0; y < rows;)
+            {
+                auto has = [&](int yi)
+                { return x == cols || left[yi * cols + x]; };
+
+                if (!has(y))
+                {
+                    y++;
+                    continue;
+                }
+
+                int start = y;
+
+                while (y < rows && has(y))
+                {
+                    y++;
+                }
+
+                walls.push_back(rectangle(x * c, start * c, x * c + t, y * c + t));
+            }
+        }
+    }
+
+    void corridor_walls(Random &rng, const GeneratorOptions &options, std::vector<std::vector<Point>> &walls)
+    {
+        double door = AGENT_SIZE * 2;
+
+        for (double y = 0; y <= options.height; y += options.cell)
+        {
+            bool outer = y == 0 || y + options.cell > options.height;
+            int doors = outer ? 0 : rng.integer(1, 3);
+            std::vector<double> gaps;
+
+            for (int i = 0; i < doors; i++)
+            {
+                gaps.push_back(rng.uniform(0, std::max(0.0, options.width - door)));
+            }
+
+            std::sort(gaps.begin(), gaps.end());
+            double x = 0;
+
+            for (double gap : gaps)
+            {
+                if (gap > x)
+                {
+                    walls.push_back(rectangle(x, y, gap, y + WALL_THICKNESS));
+                }
+
+                x = std::max(x, gap + door);
+            }
+
+            if (x < options.width)
+            {
+                walls.push_back(rectangle(x, y, options.width, y + WALL_THICKNESS));
+            }
+        }
+    }
+
+    Rect bounds_of(const std::vector<Point> &pts)
+    {
+        Rect rect{pts.front(), pts.front()};
+
+        for (const auto &p : pts)
+        {
+            rect.first.x = std::min(rect.first.x, p.x);
+            rect.first.y = std::min(rect.first.y, p.y);
+            rect.second.x = std::max(rect.second.x, p.x);
+            rect.second.y = std::max(rect.second.y, p.y);
+        }
+
+        return rect;
+    }
+}
+
+std::vector<Point> star_polygon(Random &rng, Point center, double radius, bool convex, int max_vertices)
+{
+    int n = rng.integer(3, max_vertices);
+    std::vector<Point> pts;
+
+    for (int i = 0; i < n; i++)
+    {
+        // The gaps between the angles must stay below 180 degrees, otherwise the polygon can intersect itself
+        double a = (i + rng.uniform(0, 0.5)) * 2 * PI / n;
+        double r = convex ? radius : rng.uniform(radius * 0.3, radius);
+        pts.emplace_back(center.x + cos(a) * r, center.y + sin(a) * r);
+    }
+
+    return pts;
+}
+
+GeneratorOptions::Layout GeneratorOptions::parse_layout(const std::string &name)
+{
+    if (name == "random")
+    {
+        return Layout::RANDOM;
+    }
+    else if (name == "maze")
+    {
+        return Layout::MAZE;
+    }
+    else if (name == "corridors")
+    {
+        return Layout::CORRIDORS;
+    }
+
+    throw Error("Unknown scene layout: " + name);
+}
+
+void GeneratorOptions::validate() const
+{
+    // Written so that NaN fails the checks too
+    auto check_size = [](const char *name, double value)
+    {
+        if (!(value > 0 && value <= MAX_SIZE))
+        {
+            std::ostringstream message;
+            message << "The " << name << " must be greater than 0 and at most " << (int)MAX_SIZE << ", got " << value;
+            throw Error(message.str());
+        }
+    };
+
+    auto check_count = [](const char *name, int value)
+    {
+        if (value < 0 || value > MAX_OBJECTS)
+        {
+            std::ostringstream message;
+            message << "The number of " << name << " must be between 0 and " << MAX_OBJECTS << ", got " << value;
+            throw Error(message.str());
+        }
+    };
+
+    check_size("width", width);
+    check_size("height", height);
+    check_size("cell size", cell);
+    check_count("walls", walls);
+    check_count("agents", agents);
+
+    if (std::ceil(width / cell) * std::ceil(height / cell) > MAX_CELLS)
+    {
+        std::ostringstream message;
+        message << "The cell size " << cell << " is too small for a " << width << "x" << height << " world";
+        throw Error(message.str());
+    }
+}
+
+SceneData generate_scene(const GeneratorOptions &options)
+{
+    options.validate();
+    Random rng(options.seed);
+    std::vector<std::vector<Point>> walls;
+
+    switch (options.layout)
+    {
+    case GeneratorOptions::Layout::RANDOM:
+        random_walls(rng, options, walls);
+        break;
+
+    case GeneratorOptions::Layout::MAZE:
+        maze_walls(rng, options, walls);
+        break;
+
+    case GeneratorOptions::Layout::CORRIDORS:
+        corridor_walls(rng, options, walls);
+        break;
+    }
+
+    SceneData scene;
+
+    // The bounding rectangles of everything placed so far, used to find free space for the navigators
+    std::vector<Rect> rects;
+    rects.reserve(walls.size() + options.agents);
+    SpatialGrid<Rect> occupied(AGENT_SIZE * 2);
+
+    for (const auto &w : walls)
+    {
+        scene.add_wall(w);
+        rects.push_back(bounds_of(w));
+        occupied.insert(&rects.back(), rects.back());
+    }
+
+    int placed = 0;
+
+    for (int attempt = 0; placed < options.agents && attempt < options.agents * 50; attempt++)
+    {
+        Point pos{rng.uniform(0, std::max(0.0, options.width - AGENT_SIZE)),
+                  rng.uniform(0, std::max(0.0, options.height - AGENT_SIZE))};
+        Rect rect{pos, pos + Point{AGENT_SIZE, AGENT_SIZE}};
+
+        // Rotated navigators extend past their bounding rectangle, keep some distance to everything else
+        Rect margin{rect.first - Point{AGENT_SIZE / 4, AGENT_SIZE / 4}, rect.second + Point{AGENT_SIZE / 4, AGENT_SIZE / 4}};
+
+        if (!occupied.any_of(margin, [&](Rect *r)
+                             { return overlaps(margin, *r); }))
+        {
+            scene.add_agent(pos, rng.uniform(0, 360), true, true);
+            rects.push_back(rect);
+            occupied.insert(&rects.back(), rect);
+            placed++;
+        }
+    }
+
+    if (placed < options.agents)
+    {
+        std::cout << "Only found room for " << placed << " of " << options.agents << " navigators" << std::endl;
+    }
+
+    return scene;
+}
@@ -0,0 +1,81 @@
+#pragma once
+
+#include "scene.hh"
+
+#include <random>
+#include <string>
+#include <vector>
+
+// Random numbers that are the same on every platform. The standard distributions are implementation defined,
+// this only relies on the raw output of the engine which is the same everywhere.
+class Random
+{
+public:
+    Random(uint64_t seed)
+        : m_engine(seed)
+    {
+    }
+
+    // A number in the range [lo, hi)
+    double uniform(double lo, double hi)
+    {
+        return lo + (m_engine() >> 11) * 0x1.0p-53 * (hi - lo);
+    }
+
+    // A number in the range [lo, hi]
+    int integer(int lo, int hi)
+    {
+        return lo + m_engine() % (uint64_t)(hi - lo + 1);
+    }
+
+private:
+    std::mt19937_64 m_engine;
+};
+
+// A star-shaped polygon around a center point with 3 to max_vertices vertices. A convex polygon has all of its
+// vertices at the radius, otherwise they are somewhere between 0.3 and 1 times the radius from the center.
+std::vector<Point> star_polygon(Random &rng, Point center, double radius, bool convex, int max_vertices = 12);
+
+// Generates large scenes for stress testing. The same options always produce the same scene on every
+// platform.
+struct GeneratorOptions
+{
+    enum class Layout
+    {
+        RANDOM,    // Randomly placed convex and concave polygons
+        MAZE,      // A perfect maze built out of thin walls
+        CORRIDORS, // Long horizontal walls with doorways in them
+    };
+
+    Layout layout = Layout::RANDOM;
+    uint64_t seed = 1;
+    double width = 4000;
+    double height = 4000;
+
+    // The number of polygons for the RANDOM layout
+    int walls = 200;
+
+    // The size of a maze cell or the distance between corridor walls
+    double cell = 150;
+
+    // The number of navigators to place in the free space
+    int agents = 100;
+
+    // The largest world size and number of walls or navigators that can be generated
+    static constexpr double MAX_SIZE = 1000000;
+    static constexpr int MAX_OBJECTS = 1000000;
+
+    // The largest number of maze cells, the world is split into cells of the cell size in both directions
+    static constexpr double MAX_CELLS = 10000000;
+
+    // Parses the layout name
+    static Layout parse_layout(const std::string &name);
+
+    // Throws an Error if the options are out of range: the sizes must be positive and finite, the numbers of
+    // walls and navigators can't be negative and none of them can be large enough to run out of memory
+    void validate() const;
+};
+
+// Generate a scene, the options are validated first. Navigators are placed so that they don't overlap the walls or each other. If there's not
+// enough free space, fewer navigators are placed than requested.
+SceneData generate_scene(const GeneratorOptions &options);
@@ -1,54 +1,726 @@
 #include "graphics.hh"
 
+#include <algorithm>
 #include <cassert>
+#include <cstring>
+#include <map>
+#include <memory>
+#include <tuple>
 #include <unordered_map>
 
+//
+// Camera
+//
+
+Camera::Camera(int width, int height)
+    : m_width(width), m_height(height)
+{
+}
+
+void Camera::set_screen_size(int width, int height)
+{
+    m_width = width;
+    m_height = height;
+}
+
+Point Camera::to_screen(const Point &world) const
+{
+    return (world - m_pos) * m_zoom;
+}
+
+Point Camera::to_world(const Point &screen) const
+{
+    return screen * (1.0 / m_zoom) + m_pos;
+}
+
+Rect Camera::view() const
+{
+    return {m_pos, to_world(Point(m_width, m_height))};
+}
+
+const Point &Camera::position() const
+{
+    return m_pos;
+}
+
+void Camera::set_position(Point position)
+{
+    m_pos = position;
+}
+
+double Camera::zoom() const
+{
+    return m_zoom;
+}
+
+void Camera::pan(Point delta)
+{
+    m_pos += delta * (1.0 / m_zoom);
+}
+
+void Camera::zoom_at(Point screen, double factor)
+{
+    auto world = to_world(screen);
+    m_zoom = std::clamp(m_zoom * factor, 0.01, 100.0);
+    m_pos = world - screen * (1.0 / m_zoom);
+}
+
+//
+// Batch
+//
+
+namespace
+{
+    // The corners of a quad that covers the line and is width wide, or false if the line has no length
+    bool line_quad(const Point &p1, const Point &p2, double width, Point corners[4])
+    {
+        auto d = p2 - p1;
+        double len = sqrt(d.dot(d));
+
+        if (len == 0)
+        {
+            return false;
+        }
+
+        // Offset the end points along the normal of the line to get the corners of the quad
+        Point n{-d.y * width / (2 * len), d.x * width / (2 * len)};
+        corners[0] = p1 + n;
+        corners[1] = p2 + n;
+        corners[2] = p2 - n;
+        corners[3] = p1 - n;
+        return true;
+    }
+}
+
+void Batch::clear()
+{
+    m_vertices.clear();
+    m_indices.clear();
+}
+
+int Batch::add_vertex(const Point &p, const Color &color)
+{
+    SDL_Vertex v;
+    v.position = {(float)p.x, (float)p.y};
+    v.color = {color.red, color.green, color.blue, color.alpha};
+    v.tex_coord = {0, 0};
+    m_vertices.push_back(v);
+    return m_vertices.size() - 1;
+}
+
+void Batch::add_triangle(int a, int b, int c)
+{
+    m_indices.push_back(a);
+    m_indices.push_back(b);
+    m_indices.push_back(c);
+}
+
+void Batch::add_line(const Point &p1, const Point &p2, double width, const Color &color)
+{
+    Point corners[4];
+
+    if (!line_quad(p1, p2, width, corners))
+    {
+        return;
+    }
+
+    int a = add_vertex(corners[0], color);
+    int b = add_vertex(corners[1], color);
+    int c = add_vertex(corners[2], color);
+    int e = add_vertex(corners[3], color);
+    add_triangle(a, b, c);
+    add_triangle(a, c, e);
+}
+
+void Batch::draw(SDL_Renderer *renderer) const
+{
+    if (!m_indices.empty())
+    {
+        SDL_RenderGeometry(renderer, nullptr, m_vertices.data(), m_vertices.size(), m_indices.data(), m_indices.size());
+    }
+}
+
+size_t Batch::triangles() const
+{
+    return m_indices.size() / 3;
+}
+
+//
+// DebugDraw
+//
+
+// static
+const char *DebugDraw::name(Layer layer)
+{
+    switch (layer)
+    {
+    case Layer::PATHS:
+        return "paths";
+    case Layer::EXPANSIONS:
+        return "expansions";
+    case Layer::SPATIAL_CELLS:
+        return "spatial index cells";
+    }
+
+    return "unknown";
+}
+
+void DebugDraw::begin(Layer layer, const void *owner)
+{
+    assert(!m_current);
+    remove(layer, owner);
+    m_current = &m_layers[(int)layer];
+    m_owner = owner;
+    m_start = m_current->primitives.size();
+}
+
+void DebugDraw::add_line(const Point &p1, const Point &p2, const Color &color)
+{
+    add({{p1, p2, p2}, color, false, true});
+}
+
+void DebugDraw::add_triangle(const Point &p1, const Point &p2, const Point &p3, const Color &color)
+{
+    add({{p1, p2, p3}, color, true, true});
+}
+
+void DebugDraw::add_rect(const Rect &rect, const Color &color)
+{
+    Point a = rect.first;
+    Point b{rect.second.x, rect.first.y};
+    Point c = rect.second;
+    Point d{rect.first.x, rect.second.y};
+    add_line(a, b, color);
+    add_line(b, c, color);
+    add_line(c, d, color);
+    add_line(d, a, color);
+}
+
+void DebugDraw::add(Primitive primitive)
+{
+    assert(m_current);
+    m_current->primitives.push_back(primitive);
+}
+
+void DebugDraw::end()
+{
+    assert(m_current);
+    uint32_t count = m_current->primitives.size() - m_start;
+
+    if (count)
+    {
+        m_current->owners[m_owner] = {m_start, count};
+    }
+
+    m_current = nullptr;
+}
+
+void DebugDraw::remove(Layer layer, const void *owner)
+{
+    auto &data = m_layers[(int)layer];
+    auto it = data.owners.find(owner);
+
+    if (it != data.owners.end())
+    {
+        for (uint32_t i = it->second.start; i < it->second.start + it->second.count; i++)
+        {
+            data.primitives[i].live = false;
+
+            // Already projected, collapse the quad into its first vertex
+            if (i < data.projected)
+            {
+                std::fill_n(data.indices.begin() + i * 6, 6, i * 4);
+            }
+        }
+
+        data.dead += it->second.count;
+        data.owners.erase(it);
+        compact(data);
+    }
+}
+
+void DebugDraw::compact(LayerData &layer)
+{
+    if (layer.dead * 2 <= layer.primitives.size())
+    {
+        return;
+    }
+
+    // The primitives of each owner are contiguous, so the spans only need to be moved down
+    std::vector<std::pair<const void *, Span>> spans(layer.owners.begin(), layer.owners.end());
+    std::sort(spans.begin(), spans.end(), [](const auto &lhs, const auto &rhs)
+              { return lhs.second.start < rhs.second.start; });
+
+    uint32_t out = 0;
+
+    for (auto &[owner, span] : spans)
+    {
+        // The destination is always before the source, unless the span is already where it belongs. Copying it
+        // onto itself isn't allowed.
+        if (span.start != out)
+        {
+            std::copy(layer.primitives.begin() + span.start, layer.primitives.begin() + span.start + span.count,
+                      layer.primitives.begin() + out);
+            layer.owners[owner].start = out;
+
+            // The vertices of the moved primitives are projected again on the next draw
+            layer.projected = std::min<size_t>(layer.projected, out);
+        }
+
+        out += span.count;
+    }
+
+    layer.primitives.resize(out);
+    layer.projected = std::min<size_t>(layer.projected, out);
+    layer.dead = 0;
+}
+
+void DebugDraw::clear(Layer layer)
+{
+    auto &data = m_layers[(int)layer];
+    data.primitives.clear();
+    data.owners.clear();
+    data.dead = 0;
+    data.projected = 0;
+}
+
+void DebugDraw::set_enabled(Layer layer, bool enabled)
+{
+    m_layers[(int)layer].enabled = enabled;
+}
+
+bool DebugDraw::is_enabled(Layer layer) const
+{
+    return m_layers[(int)layer].enabled;
+}
+
+void DebugDraw::project(LayerData &layer, const Camera &camera)
+{
+    layer.vertices.resize(layer.primitives.size() * 4);
+    layer.indices.resize(layer.primitives.size() * 6);
+
+    for (size_t i = layer.projected; i < layer.primitives.size(); i++)
+    {
+        const auto &p = layer.primitives[i];
+        Point corners[4];
+        int first = i * 4;
+        int *indices = &layer.indices[i * 6];
+
+        if (!p.live)
+        {
+            std::fill_n(indices, 6, first);
+            continue;
+        }
+
+        if (p.triangle)
+        {
+            corners[0] = camera.to_screen(p.p[0]);
+            corners[1] = camera.to_screen(p.p[1]);
+            corners[2] = camera.to_screen(p.p[2]);
+            corners[3] = corners[2];
+            int order[6] = {0, 1, 2, 0, 0, 0};
+
+            for (int j = 0; j < 6; j++)
+            {
+                indices[j] = first + order[j];
+            }
+        }
+        else if (line_quad(camera.to_screen(p.p[0]), camera.to_screen(p.p[1]), 1, corners))
+        {
+            int order[6] = {0, 1, 2, 0, 2, 3};
+
+            for (int j = 0; j < 6; j++)
+            {
+                indices[j] = first + order[j];
+            }
+        }
+        else
+        {
+            std::fill_n(indices, 6, first);
+        }
+
+        for (int j = 0; j < 4; j++)
+        {
+            auto &v = layer.vertices[first + j];
+            v.position = {(float)corners[j].x, (float)corners[j].y};
+            v.color = {p.color.red, p.color.green, p.color.blue, p.color.alpha};
+            v.tex_coord = {0, 0};
+        }
+    }
+
+    layer.projected = layer.primitives.size();
+}
+
+void DebugDraw::draw(SDL_Renderer *renderer, const Camera &camera)
+{
+    for (auto &layer : m_layers)
+    {
+        if (!layer.enabled || layer.primitives.size() == layer.dead)
+        {
+            continue;
+        }
+
+        // Moving the camera moves every vertex on the screen
+        if (!(layer.camera_pos == camera.position()) || layer.camera_zoom != camera.zoom())
+        {
+            layer.projected = 0;
+            layer.camera_pos = camera.position();
+            layer.camera_zoom = camera.zoom();
+        }
+
+        if (layer.projected < layer.primitives.size())
+        {
+            project(layer, camera);
+        }
+
+        SDL_RenderGeometry(renderer, nullptr, layer.vertices.data(), layer.vertices.size(), layer.indices.data(),
+                           layer.indices.size());
+    }
+}
+
 //
 // Polygon
 //
 
-Polygon::Polygon(Object *obj, SDL_Renderer *renderer)
-    : m_obj(obj), m_renderer(renderer)
+void rasterize_polygon(const std::vector<Point> &pts, const Point &offset, const Color &fill, const Color &outline,
+                       void *pixels, int width, int height, int pitch)
 {
-    // Add some extra space so that bounding lines are drawn correctly for rectangles
-    auto [min, max] = m_obj->bounding_rect();
-    m_width = (max.x - 0) + 5;
-    m_height = (max.y - 0) + 5;
+    auto to_pixel = [](const Color &c)
+    {
+        return (uint32_t)c.red << 24 | (uint32_t)c.green << 16 | (uint32_t)c.blue << 8 | c.alpha;
+    };
+
+    auto row = [&](int y)
+    {
+        return reinterpret_cast<uint32_t *>(static_cast<uint8_t *>(pixels) + (size_t)y * pitch);
+    };
+
+    struct Edge
+    {
+        double y_min;
+        double y_max;
+        double x;     // X at y_min
+        double slope; // Change of x per unit of y
+    };
+
+    std::vector<Edge> edges;
+    edges.reserve(pts.size());
+
+    for (size_t i = 0; i < pts.size(); i++)
+    {
+        auto a = pts[i] - offset;
+        auto b = pts[(i + 1) % pts.size()] - offset;
+
+        // Horizontal edges never cross a pixel center row, the outline takes care of drawing them
+        if (a.y != b.y)
+        {
+            if (a.y > b.y)
+            {
+                std::swap(a, b);
+            }
+
+            edges.push_back({a.y, b.y, a.x, (b.x - a.x) / (b.y - a.y)});
+        }
+    }
+
+    std::sort(edges.begin(), edges.end(), [](const auto &lhs, const auto &rhs)
+              { return lhs.y_min < rhs.y_min; });
+
+    // The edges that cross the current row and the x coordinates of the crossings
+    std::vector<const Edge *> active;
+    std::vector<double> xs;
+    active.reserve(edges.size());
+    xs.reserve(edges.size());
+    size_t next = 0;
+    const uint32_t fill_pixel = to_pixel(fill);
+
+    for (int y = 0; y < height; y++)
+    {
+        uint32_t *out = row(y);
+        std::fill(out, out + width, 0);
+
+        // Rows are sampled at the pixel centers
+        double yc = y + 0.5;
+
+        while (next < edges.size() && edges[next].y_min <= yc)
+        {
+            active.push_back(&edges[next++]);
+        }
+
+        active.erase(std::remove_if(active.begin(), active.end(), [&](auto e)
+                                    { return e->y_max <= yc; }),
+                     active.end());
 
-    m_texture = SDL_CreateTexture(m_renderer, SDL_PIXELFORMAT_RGBA8888, SDL_TEXTUREACCESS_TARGET, m_width, m_height);
+        xs.clear();
+
+        for (auto e : active)
+        {
+            xs.push_back(e->x + (yc - e->y_min) * e->slope);
+        }
+
+        std::sort(xs.begin(), xs.end());
+
+        // Even-odd rule, fill the pixels whose centers are between pairs of crossings
+        for (size_t i = 0; i + 1 < xs.size(); i += 2)
+        {
+            int x0 = std::max(0, (int)ceil(xs[i] - 0.5));
+            int x1 = std::min(width, (int)ceil(xs[i + 1] - 0.5));
+            std::fill(out + std::min(x0, x1), out + x1, fill_pixel);
+        }
+    }
+
+    const uint32_t outline_pixel = to_pixel(outline);
+
+    for (size_t i = 0; i < pts.size(); i++)
+    {
+        auto a = pts[i] - offset;
+        auto b = pts[(i + 1) % pts.size()] - offset;
+        auto d = b - a;
+        int steps = std::max(1, (int)ceil(std::max(fabs(d.x), fabs(d.y))));
+
+        for (int s = 0; s <= steps; s++)
+        {
+            auto p = a + d * ((double)s / steps);
+            int x = p.x;
+            int y = p.y;
+
+            if (x >= 0 && y >= 0 && x < width && y < height)
+            {
+                row(y)[x] = outline_pixel;
+            }
+        }
+    }
 }
 
-Polygon::~Polygon()
+namespace
 {
-    SDL_DestroyTexture(m_texture);
+    // Splits a simple polygon into triangles by clipping ears off of it. Returns the triangles as indices into
+    // the points. If the polygon intersects itself and no ear can be found, the rest is triangulated as a fan.
+    std::vector<int> triangulate(const std::vector<Point> &pts)
+    {
+        std::vector<int> result;
+
+        if (pts.size() < 3)
+        {
+            return result;
+        }
+
+        std::vector<int> idx(pts.size());
+
+        for (size_t i = 0; i < idx.size(); i++)
+        {
+            idx[i] = i;
+        }
+
+        // Twice the signed area, the sign tells the winding order
+        double area = 0;
+
+        for (size_t i = 0; i < pts.size(); i++)
+        {
+            area += pts[i].cross(pts[(i + 1) % pts.size()]);
+        }
+
+        double sign = area < 0 ? -1 : 1;
+
+        auto convex = [&](const Point &a, const Point &b, const Point &c)
+        {
+            return (b - a).cross(c - b) * sign > 0;
+        };
+
+        auto inside = [&](const Point &p, const Point &a, const Point &b, const Point &c)
+        {
+            return (b - a).cross(p - a) * sign >= 0 && (c - b).cross(p - b) * sign >= 0 && (a - c).cross(p - c) * sign >= 0;
+        };
+
+        while (idx.size() > 3)
+        {
+            bool found = false;
+
+            for (size_t i = 0; i < idx.size() && !found; i++)
+            {
+                int ia = idx[(i + idx.size() - 1) % idx.size()];
+                int ib = idx[i];
+                int ic = idx[(i + 1) % idx.size()];
+
+                if (!convex(pts[ia], pts[ib], pts[ic]))
+                {
+                    continue;
+                }
+
+                bool ear = std::none_of(idx.begin(), idx.end(), [&](int j)
+                                        { return j != ia && j != ib && j != ic && inside(pts[j], pts[ia], pts[ib], pts[ic]); });
+
+                if (ear)
+                {
+                    result.insert(result.end(), {ia, ib, ic});
+                    idx.erase(idx.begin() + i);
+                    found = true;
+                }
+            }
+
+            if (!found)
+            {
+                break;
+            }
+        }
+
+        for (size_t i = 1; i + 1 < idx.size(); i++)
+        {
+            result.insert(result.end(), {idx[0], idx[i], idx[i + 1]});
+        }
+
+        return result;
+    }
 }
 
-void Polygon::redraw()
+//
+// TextureCache
+//
+
+namespace
 {
-    SDL_SetRenderTarget(m_renderer, m_texture);
+    struct CachedTexture
+    {
+        SDL_Renderer *renderer;
+        std::vector<Point> outline;
+        Color fill;
+        Color outline_color;
+        TextureCache::Handle texture;
+    };
 
-    // Set blendmode so that alpha blending works correctly (by default it doesn't).
-    SDL_SetTextureBlendMode(m_texture, SDL_BLENDMODE_BLEND);
+    struct TextureCacheData
+    {
+        std::unordered_multimap<uint64_t, CachedTexture> entries;
+        size_t trim_limit = 64;
+    };
 
-    SDL_SetRenderDrawColor(m_renderer, 0, 0, 0, 0);
-    SDL_Rect rect{0, 0, m_width, m_height};
-    SDL_RenderFillRect(m_renderer, &rect);
+    TextureCacheData s_texture_cache;
 
-    SDL_SetRenderDrawColor(m_renderer, m_fill.red, m_fill.green, m_fill.blue, m_fill.alpha);
+    uint64_t mix(uint64_t h, uint64_t value)
+    {
+        // FNV-1a style mixing of 64-bit values
+        return (h ^ value) * 0x100000001b3ull;
+    }
 
-    for (const auto &line : m_obj->scan_lines())
+    uint64_t color_bits(const Color &c)
     {
-        SDL_RenderDrawLineF(m_renderer, line.first.x, line.first.y, line.second.x, line.second.y);
+        return (uint64_t)c.red << 24 | (uint64_t)c.green << 16 | (uint64_t)c.blue << 8 | c.alpha;
     }
 
-    SDL_SetRenderDrawColor(m_renderer, m_outline.red, m_outline.green, m_outline.blue, m_outline.alpha);
+    bool operator==(const Color &lhs, const Color &rhs)
+    {
+        return color_bits(lhs) == color_bits(rhs);
+    }
+}
 
-    for (const auto &line : m_obj->bounding_lines())
+// static
+uint64_t TextureCache::hash(const std::vector<Point> &outline)
+{
+    uint64_t h = 0xcbf29ce484222325ull;
+
+    for (const auto &p : outline)
+    {
+        uint64_t bits[2];
+        memcpy(bits, &p, sizeof(bits));
+        h = mix(mix(h, bits[0]), bits[1]);
+    }
+
+    return h;
+}
+
+// static
+TextureCache::Handle TextureCache::get(SDL_Renderer *renderer, const std::vector<Point> &outline, uint64_t hash,
+                                       const Point &offset, int width, int height, const Color &fill, const Color &outline_color)
+{
+    auto &cache = s_texture_cache;
+    uint64_t key = mix(mix(mix(hash, color_bits(fill)), color_bits(outline_color)), (uintptr_t)renderer);
+    auto [begin, end] = cache.entries.equal_range(key);
+
+    for (auto it = begin; it != end; ++it)
+    {
+        const auto &e = it->second;
+
+        if (e.renderer == renderer && e.fill == fill && e.outline_color == outline_color && e.outline == outline)
+        {
+            return e.texture;
+        }
+    }
+
+    if (cache.entries.size() >= cache.trim_limit)
+    {
+        trim();
+        cache.trim_limit = std::max<size_t>(64, cache.entries.size() * 2);
+    }
+
+    Handle texture(SDL_CreateTexture(renderer, SDL_PIXELFORMAT_RGBA8888, SDL_TEXTUREACCESS_STREAMING, width, height),
+                   SDL_DestroyTexture);
+
+    // Set blendmode so that alpha blending works correctly (by default it doesn't).
+    SDL_SetTextureBlendMode(texture.get(), SDL_BLENDMODE_BLEND);
+
+    void *pixels;
+    int pitch;
+
+    if (SDL_LockTexture(texture.get(), nullptr, &pixels, &pitch) == 0)
+    {
+        rasterize_polygon(outline, offset, fill, outline_color, pixels, width, height, pitch);
+        SDL_UnlockTexture(texture.get());
+    }
+
+    cache.entries.emplace(key, CachedTexture{renderer, outline, fill, outline_color, texture});
+    return texture;
+}
+
+// static
+void TextureCache::trim()
+{
+    auto &entries = s_texture_cache.entries;
+
+    for (auto it = entries.begin(); it != entries.end();)
     {
-        SDL_RenderDrawLineF(m_renderer, line.first.x, line.first.y, line.second.x, line.second.y);
+        // Only referenced by the cache itself
+        if (it->second.texture.use_count() == 1)
+        {
+            it = entries.erase(it);
+        }
+        else
+        {
+            ++it;
+        }
     }
+}
 
-    SDL_SetRenderTarget(m_renderer, nullptr);
+// static
+void TextureCache::clear()
+{
+    s_texture_cache.entries.clear();
+}
+
+// static
+size_t TextureCache::size()
+{
+    return s_texture_cache.entries.size();
+}
+
+Polygon::Polygon(Object *obj, SDL_Renderer *renderer)
+    : m_obj(obj), m_renderer(renderer)
+{
+    // Add some extra space so that bounding lines are drawn correctly for rectangles
+    auto [min, max] = m_obj->bounding_rect();
+    m_offset = min;
+    m_width = (max.x - min.x) + 5;
+    m_height = (max.y - min.y) + 5;
+    m_triangles = triangulate(m_obj->bounds());
+    m_hash = TextureCache::hash(m_obj->bounds());
+}
+
+Polygon::~Polygon()
+{
+}
+
+void Polygon::redraw()
+{
+    m_dirty = true;
 }
 
 void Polygon::set_fill(const Color &color)
@@ -61,13 +733,50 @@ void Polygon::set_outline(const Color &color)
     m_outline = color;
 }
 
-void Polygon::render(SDL_Renderer *renderer) const
+void Polygon::render(SDL_Renderer *renderer, const Camera &camera) const
 {
-    auto pos = m_obj->position();
-    SDL_Rect dstrect{(int)pos.x, (int)pos.y, m_width, m_height};
-    SDL_Point rot{(int)m_obj->center().x, (int)m_obj->center().y};
+    if (m_dirty)
+    {
+        m_texture = TextureCache::get(m_renderer, m_obj->bounds(), m_hash, m_offset, m_width, m_height, m_fill, m_outline);
+        m_dirty = false;
+    }
 
-    SDL_RenderCopyEx(renderer, m_texture, nullptr, &dstrect, m_obj->rotation(), &rot, SDL_FLIP_NONE);
+    auto pos = camera.to_screen(m_obj->position() + m_offset);
+    auto zoom = camera.zoom();
+    SDL_FRect dstrect{(float)pos.x, (float)pos.y, (float)(m_width * zoom), (float)(m_height * zoom)};
+    auto center = (m_obj->center() - m_offset) * zoom;
+    SDL_FPoint rot{(float)center.x, (float)center.y};
+
+    SDL_RenderCopyExF(renderer, m_texture.get(), nullptr, &dstrect, m_obj->rotation(), &rot, SDL_FLIP_NONE);
+}
+
+void Polygon::append(Batch &batch, const Camera &camera) const
+{
+    // Walls never move so their world coordinates are only calculated once
+    if (m_points.empty() || !(m_points_pos == m_obj->position()) || m_points_dir != m_obj->rotation())
+    {
+        m_points = m_obj->points();
+        m_points_pos = m_obj->position();
+        m_points_dir = m_obj->rotation();
+    }
+
+    int base = -1;
+
+    for (const auto &p : m_points)
+    {
+        int i = batch.add_vertex(camera.to_screen(p), m_fill);
+        base = base == -1 ? i : base;
+    }
+
+    for (size_t i = 0; i < m_triangles.size(); i += 3)
+    {
+        batch.add_triangle(base + m_triangles[i], base + m_triangles[i + 1], base + m_triangles[i + 2]);
+    }
+
+    for (size_t i = 0; i < m_points.size(); i++)
+    {
+        batch.add_line(camera.to_screen(m_points[i]), camera.to_screen(m_points[(i + 1) % m_points.size()]), 1.0, m_outline);
+    }
 }
 
 //
@@ -102,6 +811,128 @@ Texture::~Texture()
 // Text
 //
 
+// The printable ASCII characters of one font rendered into a single texture
+class GlyphAtlas
+{
+public:
+    struct Glyph
+    {
+        SDL_Rect rect{0, 0, 0, 0};
+        int advance{0};
+    };
+
+    GlyphAtlas &operator=(const GlyphAtlas &) = delete;
+    GlyphAtlas(const GlyphAtlas &) = delete;
+
+    GlyphAtlas(SDL_Renderer *renderer, TTF_Font *font)
+        : m_line_skip(TTF_FontLineSkip(font))
+    {
+        SDL_Surface *surfaces[COUNT] = {};
+        int x = 0;
+        int y = 0;
+        int row_height = 0;
+
+        // The glyphs are rendered in white so that the vertex colors can be used to tint them
+        for (int i = 0; i < COUNT; i++)
+        {
+            SDL_Surface *glyph = TTF_RenderGlyph_Blended(font, FIRST + i, {255, 255, 255, 255});
+
+            if (!glyph)
+            {
+                continue;
+            }
+
+            surfaces[i] = SDL_ConvertSurfaceFormat(glyph, SDL_PIXELFORMAT_ARGB8888, 0);
+            SDL_FreeSurface(glyph);
+
+            if (!surfaces[i])
+            {
+                continue;
+            }
+
+            if (x + surfaces[i]->w > WIDTH)
+            {
+                x = 0;
+                y += row_height + 1;
+                row_height = 0;
+            }
+
+            auto &g = m_glyphs[i];
+            g.rect = {x, y, surfaces[i]->w, surfaces[i]->h};
+            TTF_GlyphMetrics(font, FIRST + i, nullptr, nullptr, nullptr, nullptr, &g.advance);
+            x += surfaces[i]->w + 1;
+            row_height = std::max(row_height, surfaces[i]->h);
+        }
+
+        int height = std::max(1, y + row_height);
+        m_height = height;
+        m_texture = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_ARGB8888, SDL_TEXTUREACCESS_STATIC, WIDTH, height);
+
+        if (m_texture)
+        {
+            SDL_SetTextureBlendMode(m_texture, SDL_BLENDMODE_BLEND);
+
+            // The gaps between the glyphs must be transparent
+            std::vector<uint32_t> empty(WIDTH * height, 0);
+            SDL_UpdateTexture(m_texture, nullptr, empty.data(), WIDTH * sizeof(uint32_t));
+        }
+
+        for (int i = 0; i < COUNT; i++)
+        {
+            if (surfaces[i])
+            {
+                if (m_texture)
+                {
+                    SDL_UpdateTexture(m_texture, &m_glyphs[i].rect, surfaces[i]->pixels, surfaces[i]->pitch);
+                }
+
+                SDL_FreeSurface(surfaces[i]);
+            }
+        }
+    }
+
+    ~GlyphAtlas()
+    {
+        if (m_texture)
+        {
+            SDL_DestroyTexture(m_texture);
+        }
+    }
+
+    // Returns nullptr if the character is not in the atlas
+    const Glyph *glyph(char c) const
+    {
+        int i = (unsigned char)c - FIRST;
+        return i >= 0 && i < COUNT ? &m_glyphs[i] : nullptr;
+    }
+
+    int line_skip() const
+    {
+        return m_line_skip;
+    }
+
+    SDL_Texture *texture() const
+    {
+        return m_texture;
+    }
+
+    int height() const
+    {
+        return m_height;
+    }
+
+    static constexpr int WIDTH = 512;
+
+private:
+    static constexpr int FIRST = ' ';
+    static constexpr int COUNT = '~' - FIRST + 1;
+
+    SDL_Texture *m_texture{nullptr};
+    Glyph m_glyphs[COUNT];
+    int m_line_skip;
+    int m_height{1};
+};
+
 class FontLoader
 {
 public:
@@ -135,8 +966,24 @@ public:
         return it->second;
     }
 
+    // The atlas is created the first time it's needed for the renderer
+    const GlyphAtlas &atlas(SDL_Renderer *renderer, const std::string &filename, int size)
+    {
+        auto key = std::make_tuple(renderer, filename, size);
+        auto it = m_atlases.find(key);
+
+        if (it == m_atlases.end())
+        {
+            auto atlas = std::make_unique<GlyphAtlas>(renderer, load(filename, size));
+            it = m_atlases.emplace(key, std::move(atlas)).first;
+        }
+
+        return *it->second;
+    }
+
 private:
     std::unordered_map<std::string, TTF_Font *> m_fonts;
+    std::map<std::tuple<SDL_Renderer *, std::string, int>, std::unique_ptr<GlyphAtlas>> m_atlases;
 };
 
 static std::unique_ptr<FontLoader> loader;
@@ -163,30 +1010,88 @@ Text::Text(SDL_Renderer *renderer)
 {
 }
 
-void Text::set_text(std::string text, std::string font, Color color, int size)
+void Text::set_text(std::string_view text, const std::string &font, Color color, int size)
 {
+    // Only look up the atlas when the font changes, the lookup allocates the key
+    if (!m_atlas || size != m_size || font != m_font)
+    {
+        m_atlas = &loader->atlas(m_renderer, font, size);
+        m_font = font;
+        m_size = size;
+    }
+
+    m_vertices.clear();
+    m_indices.clear();
+
     SDL_Color sdl_color = {color.red, color.green, color.blue, color.alpha};
-    SDL_Surface *surface = TTF_RenderText_Solid(loader->load(font, size),
-                                                text.c_str(), sdl_color);
-    m_texture = SDL_CreateTextureFromSurface(m_renderer, surface);
-    m_rect.w = surface->w;
-    m_rect.h = surface->h;
+    float x = m_position.x;
+    float y = m_position.y;
+
+    for (char c : text)
+    {
+        if (c == '\n')
+        {
+            x = m_position.x;
+            y += m_atlas->line_skip();
+            continue;
+        }
+
+        auto *glyph = m_atlas->glyph(c);
+
+        if (!glyph)
+        {
+            continue;
+        }
+
+        const auto &r = glyph->rect;
+        int base = m_vertices.size();
+        float u0 = r.x;
+        float v0 = r.y;
+        float u1 = r.x + r.w;
+        float v1 = r.y + r.h;
 
-    SDL_FreeSurface(surface);
+        // SDL_RenderGeometry expects texture coordinates that are normalized to the texture size
+        float tw = GlyphAtlas::WIDTH;
+        float th = m_atlas->height();
+
+        m_vertices.push_back({{x, y}, sdl_color, {u0 / tw, v0 / th}});
+        m_vertices.push_back({{x + r.w, y}, sdl_color, {u1 / tw, v0 / th}});
+        m_vertices.push_back({{x + r.w, y + r.h}, sdl_color, {u1 / tw, v1 / th}});
+        m_vertices.push_back({{x, y + r.h}, sdl_color, {u0 / tw, v1 / th}});
+
+        for (int i : {0, 1, 2, 0, 2, 3})
+        {
+            m_indices.push_back(base + i);
+        }
+
+        x += glyph->advance;
+    }
 }
 
 void Text::set_position(Point point)
 {
-    m_rect.x = point.x;
-    m_rect.y = point.y;
+    // Move the already laid out glyphs instead of laying out the text again
+    float dx = point.x - m_position.x;
+    float dy = point.y - m_position.y;
+
+    for (auto &v : m_vertices)
+    {
+        v.position.x += dx;
+        v.position.y += dy;
+    }
+
+    m_position = point;
 }
 
-void Text::render(SDL_Renderer *renderer) const
+void Text::render(SDL_Renderer *renderer, const Camera &camera) const
 {
-    SDL_RenderCopyEx(renderer, m_texture, nullptr, &m_rect, 0, nullptr, SDL_FLIP_NONE);
+    if (!m_indices.empty())
+    {
+        SDL_RenderGeometry(renderer, m_atlas->texture(), m_vertices.data(), m_vertices.size(),
+                           m_indices.data(), m_indices.size());
+    }
 }
 
 Text::~Text()
 {
-    SDL_DestroyTexture(m_texture);
 }
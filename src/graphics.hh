@@ -3,6 +3,11 @@
 #include "common.hh"
 #include "objects.hh"
 
+#include <memory>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
 struct Color
 {
     uint8_t red = 0;
@@ -19,10 +24,197 @@ static constexpr const Color COLOR_WHITE = {255, 255, 255};
 static constexpr const Color COLOR_BLACK = {0, 0, 0};
 static constexpr const Color COLOR_GRAY = {125, 125, 125};
 
+// Maps world coordinates to screen coordinates. The position is the world coordinate shown at the upper left
+// corner of the screen.
+class Camera
+{
+public:
+    Camera(int width, int height);
+
+    void set_screen_size(int width, int height);
+
+    Point to_screen(const Point &world) const;
+
+    Point to_world(const Point &screen) const;
+
+    // The visible area in world coordinates
+    Rect view() const;
+
+    const Point &position() const;
+
+    void set_position(Point position);
+
+    double zoom() const;
+
+    // Move the camera by the given amount of screen pixels
+    void pan(Point delta);
+
+    // Multiply the zoom by the factor while keeping the world point under the screen point in place
+    void zoom_at(Point screen, double factor);
+
+private:
+    Point m_pos{0, 0};
+    double m_zoom{1.0};
+    int m_width;
+    int m_height;
+};
+
+// Collects untextured triangles in screen coordinates and draws all of them with one SDL_RenderGeometry call.
+// The triangles are drawn in the order they were added.
+class Batch
+{
+public:
+    void clear();
+
+    // Add a vertex, returns the index used to refer to it in add_triangle()
+    int add_vertex(const Point &p, const Color &color);
+
+    void add_triangle(int a, int b, int c);
+
+    // Add a line as a quad that is width pixels wide
+    void add_line(const Point &p1, const Point &p2, double width, const Color &color);
+
+    void draw(SDL_Renderer *renderer) const;
+
+    size_t triangles() const;
+
+private:
+    std::vector<SDL_Vertex> m_vertices;
+    std::vector<int> m_indices;
+};
+
+// Fills a polygon and draws its outline into a buffer of RGBA8888 pixels in one pass over the rows, using an
+// active edge table. Every pixel of the buffer is written. The points are shifted by -offset and the pitch is
+// the length of a row in bytes.
+void rasterize_polygon(const std::vector<Point> &pts, const Point &offset, const Color &fill, const Color &outline,
+                       void *pixels, int width, int height, int pitch);
+
+// Polygon textures shared between all polygons that have the same outline and colors. Looking up a texture
+// that's already in the cache is only a pointer swap, the polygon is only rasterized the first time.
+class TextureCache
+{
+public:
+    using Handle = std::shared_ptr<SDL_Texture>;
+
+    // Hash of an outline, calculated once per polygon
+    static uint64_t hash(const std::vector<Point> &outline);
+
+    // Get the texture for a polygon, rasterizing it if needed. The offset and size must be derived from the
+    // outline.
+    static Handle get(SDL_Renderer *renderer, const std::vector<Point> &outline, uint64_t hash,
+                      const Point &offset, int width, int height, const Color &fill, const Color &outline_color);
+
+    // Destroy the textures that are no longer used by any polygon
+    static void trim();
+
+    // Destroy all textures, must be called before the renderer is destroyed
+    static void clear();
+
+    // The number of cached textures
+    static size_t size();
+};
+
 // A graphical element that can be rendered
 struct Renderable
 {
-    virtual void render(SDL_Renderer *renderer) const = 0;
+    // Render the element. World objects are transformed with the camera, UI elements ignore it.
+    virtual void render(SDL_Renderer *renderer, const Camera &camera) const = 0;
+
+    // Add the element into a batch instead of rendering it directly. Elements that can't be batched do nothing.
+    virtual void append(Batch &batch, const Camera &camera) const
+    {
+    }
+};
+
+// Debug visualization drawn on top of the scene. The primitives are kept in world coordinates and grouped by
+// the owner that added them, so that replacing the primitives of one owner (e.g. the path of one navigator)
+// doesn't touch the rest of the layer. Each layer keeps its vertices in screen coordinates between frames and
+// is drawn with one call, only the primitives that were added since the last draw are projected unless the
+// camera has moved.
+class DebugDraw
+{
+public:
+    enum class Layer
+    {
+        PATHS,         // Planned paths
+        EXPANSIONS,    // Nodes expanded by a search
+        SPATIAL_CELLS, // Non-empty cells of the spatial index
+    };
+
+    static constexpr int LAYER_COUNT = 3;
+
+    static const char *name(Layer layer);
+
+    // Starts replacing the primitives of the owner in the layer, ended with end()
+    void begin(Layer layer, const void *owner);
+
+    void add_line(const Point &p1, const Point &p2, const Color &color);
+
+    void add_triangle(const Point &p1, const Point &p2, const Point &p3, const Color &color);
+
+    // The outline of a rectangle
+    void add_rect(const Rect &rect, const Color &color);
+
+    void end();
+
+    // Removes the primitives of the owner from the layer
+    void remove(Layer layer, const void *owner);
+
+    // Removes everything from the layer
+    void clear(Layer layer);
+
+    void set_enabled(Layer layer, bool enabled);
+
+    bool is_enabled(Layer layer) const;
+
+    // Draws the enabled layers, the primitives outside of the camera view are clipped by the renderer
+    void draw(SDL_Renderer *renderer, const Camera &camera);
+
+private:
+    struct Primitive
+    {
+        Point p[3];
+        Color color;
+        bool triangle;
+        bool live;
+    };
+
+    struct Span
+    {
+        uint32_t start;
+        uint32_t count;
+    };
+
+    struct LayerData
+    {
+        std::vector<Primitive> primitives;
+        std::unordered_map<const void *, Span> owners;
+        size_t dead{0};
+        bool enabled{false};
+
+        // Four vertices and six indices for each primitive in the same order as the primitives. The removed
+        // primitives are left in as empty triangles until the layer is compacted.
+        std::vector<SDL_Vertex> vertices;
+        std::vector<int> indices;
+
+        // The primitives before this one are projected with the camera below
+        size_t projected{0};
+        Point camera_pos;
+        double camera_zoom{0};
+    };
+
+    void add(Primitive primitive);
+
+    // Drops the removed primitives once they take up more than half of the layer
+    void compact(LayerData &layer);
+
+    // Projects the primitives that were added since the last draw into the vertices of the layer
+    void project(LayerData &layer, const Camera &camera);
+
+    LayerData m_layers[LAYER_COUNT];
+    LayerData *m_current{nullptr};
+    const void *m_owner{nullptr};
+    uint32_t m_start{0};
 };
 
 struct Polygon : public Renderable
@@ -35,19 +227,37 @@ struct Polygon : public Renderable
 
     void set_outline(const Color &color);
 
-    // Redraws the polygon, must be called whenever the color of the polygon changes
+    // Redraws the polygon, must be called whenever the color of the polygon changes. The texture is looked up
+    // from the TextureCache the next time the polygon is rendered with render() so polygons that are only
+    // batched never use one.
     void redraw();
 
-    void render(SDL_Renderer *renderer) const override;
+    // Renders the polygon with a texture of its own
+    void render(SDL_Renderer *renderer, const Camera &camera) const override;
+
+    // Adds the triangles of the polygon and its outline into the batch
+    void append(Batch &batch, const Camera &camera) const override;
 
 private:
     Object *m_obj;
     SDL_Renderer *m_renderer;
-    SDL_Texture *m_texture;
+    mutable TextureCache::Handle m_texture;
+    mutable bool m_dirty{true};
+    uint64_t m_hash;
+    // The texture only covers the bounding rectangle of the object, this is its upper left corner
+    Point m_offset;
     int m_width;
     int m_height;
     Color m_fill = COLOR_WHITE;
     Color m_outline = COLOR_BLACK;
+
+    // Triangles of the polygon as indices into the object bounds, calculated once
+    std::vector<int> m_triangles;
+
+    // The bounds in world coordinates, only recalculated when the object moves
+    mutable std::vector<Point> m_points;
+    mutable Point m_points_pos;
+    mutable double m_points_dir{0};
 };
 
 class Texture
@@ -66,25 +276,37 @@ private:
     SDL_Texture *m_texture{nullptr};
 };
 
+class GlyphAtlas;
+
+// Text drawn as quads cut out of a glyph atlas that's shared by all texts with the same font and size. Once
+// the buffers have grown large enough, changing the text doesn't allocate anything.
 class Text : public Renderable
 {
 public:
     static void init();
+
+    // Must be called before the renderers used with the texts are destroyed
     static void finish();
 
     Text(SDL_Renderer *renderer);
 
     ~Text();
 
-    void set_text(std::string text, std::string font, Color color, int size);
+    // Lays out the text, a newline starts a new line. Characters that aren't printable ASCII are skipped.
+    void set_text(std::string_view text, const std::string &font, Color color, int size);
 
-    // Position is set as the upper left corner
+    // Position is set as the upper left corner, in screen coordinates
     void set_position(Point point);
 
-    void render(SDL_Renderer *renderer) const override;
+    // Draws the whole text with one call
+    void render(SDL_Renderer *renderer, const Camera &camera) const override;
 
 private:
-    SDL_Texture *m_texture{nullptr};
     SDL_Renderer *m_renderer;
-    SDL_Rect m_rect;
+    const GlyphAtlas *m_atlas{nullptr};
+    std::string m_font;
+    int m_size{0};
+    Point m_position;
+    std::vector<SDL_Vertex> m_vertices;
+    std::vector<int> m_indices;
 };
\ No newline at end of file
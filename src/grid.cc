@@ -0,0 +1,194 @@
+#include "grid.hh"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+
+OccupancyGrid::OccupancyGrid(int width, int height, double cell_size)
+    : m_width(width), m_height(height), m_cell_size(cell_size), m_cells((size_t)width * height, 0)
+{
+    if (width <= 0 || height <= 0 || cell_size <= 0)
+    {
+        throw Error("Invalid grid size");
+    }
+}
+
+// static
+OccupancyGrid OccupancyGrid::load_map(const std::string &filename)
+{
+    std::ifstream file(filename);
+
+    if (!file)
+    {
+        throw Error("Could not open " + filename);
+    }
+
+    int width = 0;
+    int height = 0;
+    std::string key;
+
+    // The header is a list of key-value pairs that ends in a line with only "map" on it
+    while (file >> key && key != "map")
+    {
+        if (key == "width")
+        {
+            file >> width;
+        }
+        else if (key == "height")
+        {
+            file >> height;
+        }
+        else
+        {
+            file >> key;
+        }
+    }
+
+    if (key != "map" || width <= 0 || height <= 0)
+    {
+        throw Error("Invalid map header in " + filename);
+    }
+
+    OccupancyGrid grid(width, height);
+    std::string line;
+
+    for (int y = 0; y < height; y++)
+    {
+        if (!(file >> line) || (int)line.size() < width)
+        {
+            throw Error("Map " + filename + " ends on row " + std::to_string(y));
+        }
+
+        for (int x = 0; x < width; x++)
+        {
+            char c = line[x];
+            grid.m_cells[grid.index(x, y)] = c != '.' && c != 'G' && c != 'S';
+        }
+    }
+
+    return grid;
+}
+
+// static
+OccupancyGrid OccupancyGrid::from_walls(World &world, double world_width, double world_height, double cell_size)
+{
+    int width = std::max(1, (int)ceil(world_width / cell_size));
+    int height = std::max(1, (int)ceil(world_height / cell_size));
+    OccupancyGrid grid(width, height, cell_size);
+
+    std::vector<Object *> walls;
+    world.find({{0, 0}, {world_width, world_height}}, Object::Mobility::STATIC, walls);
+
+    for (auto wall : walls)
+    {
+        auto pts = wall->points();
+        auto lines = wall->lines();
+        const auto &rect = wall->world_rect();
+        auto first = grid.cell_at(rect.first);
+        auto last = grid.cell_at(rect.second);
+
+        for (int y = std::max(0, first.y); y <= std::min(height - 1, last.y); y++)
+        {
+            for (int x = std::max(0, first.x); x <= std::min(width - 1, last.x); x++)
+            {
+                Point p0{x * cell_size, y * cell_size};
+                Point p1{p0.x + cell_size, p0.y + cell_size};
+
+                // The cell is blocked if it's inside the wall, the wall is inside the cell or if the outline
+                // crosses one of the cell edges
+                bool blocked = wall->is_inside(grid.center({x, y})) ||
+                               (pts.front().x >= p0.x && pts.front().x <= p1.x &&
+                                pts.front().y >= p0.y && pts.front().y <= p1.y) ||
+                               Object::get_collisions(lines, {p0, {p1.x, p0.y}}).first ||
+                               Object::get_collisions(lines, {{p1.x, p0.y}, p1}).first ||
+                               Object::get_collisions(lines, {p1, {p0.x, p1.y}}).first ||
+                               Object::get_collisions(lines, {{p0.x, p1.y}, p0}).first;
+
+                if (blocked)
+                {
+                    grid.set_blocked(x, y, true);
+                }
+            }
+        }
+    }
+
+    return grid;
+}
+
+void OccupancyGrid::set_blocked(int x, int y, bool blocked)
+{
+    if (contains(x, y))
+    {
+        m_cells[index(x, y)] = blocked;
+    }
+}
+
+size_t OccupancyGrid::free_count() const
+{
+    return std::count(m_cells.begin(), m_cells.end(), 0);
+}
+
+GridCell OccupancyGrid::cell_at(const Point &p) const
+{
+    return {(int)floor(p.x / m_cell_size), (int)floor(p.y / m_cell_size)};
+}
+
+Point OccupancyGrid::center(const GridCell &cell) const
+{
+    return {(cell.x + 0.5) * m_cell_size, (cell.y + 0.5) * m_cell_size};
+}
+
+bool OccupancyGrid::line_of_sight(const GridCell &a, const GridCell &b) const
+{
+    if (is_blocked(a.x, a.y))
+    {
+        return false;
+    }
+
+    // Walks the cells that the line crosses in order. The line from the center of a to the center of b leaves
+    // the current cell through a vertical edge after (2 * ix + 1) / (2 * nx) of its length and through a
+    // horizontal one after (2 * iy + 1) / (2 * ny), comparing the two in integers avoids rounding errors.
+    int nx = abs(b.x - a.x);
+    int ny = abs(b.y - a.y);
+    int sx = b.x > a.x ? 1 : -1;
+    int sy = b.y > a.y ? 1 : -1;
+    int x = a.x;
+    int y = a.y;
+
+    for (int ix = 0, iy = 0; ix < nx || iy < ny;)
+    {
+        int64_t decision = (int64_t)(2 * ix + 1) * ny - (int64_t)(2 * iy + 1) * nx;
+
+        if (decision == 0)
+        {
+            // Exactly through a corner, neither of the cells beside it can be blocked
+            if (is_blocked(x + sx, y) || is_blocked(x, y + sy))
+            {
+                return false;
+            }
+
+            x += sx;
+            y += sy;
+            ix++;
+            iy++;
+        }
+        else if (decision < 0)
+        {
+            x += sx;
+            ix++;
+        }
+        else
+        {
+            y += sy;
+            iy++;
+        }
+
+        if (is_blocked(x, y))
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
@@ -0,0 +1,95 @@
+#pragma once
+
+#include "common.hh"
+#include "objects.hh"
+#include "world.hh"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// A cell of an occupancy grid
+struct GridCell
+{
+    int x = 0;
+    int y = 0;
+};
+
+inline bool operator==(const GridCell &lhs, const GridCell &rhs)
+{
+    return lhs.x == rhs.x && lhs.y == rhs.y;
+}
+
+// A uniform grid of free and blocked cells that the path planners search. Cell (0, 0) covers the world
+// rectangle from the origin to (cell_size, cell_size).
+class OccupancyGrid
+{
+public:
+    OccupancyGrid(int width, int height, double cell_size = 1.0);
+
+    // Loads a map in the MovingAI benchmark format. The passable terrain types ('.', 'G' and 'S') are free, all
+    // other cells are blocked.
+    static OccupancyGrid load_map(const std::string &filename);
+
+    // Builds a grid that covers the world from the origin to (width, height) by blocking every cell that a
+    // static object overlaps
+    static OccupancyGrid from_walls(World &world, double width, double height, double cell_size);
+
+    int width() const
+    {
+        return m_width;
+    }
+
+    int height() const
+    {
+        return m_height;
+    }
+
+    double cell_size() const
+    {
+        return m_cell_size;
+    }
+
+    bool contains(int x, int y) const
+    {
+        return x >= 0 && y >= 0 && x < m_width && y < m_height;
+    }
+
+    // Cells outside of the grid are blocked
+    bool is_blocked(int x, int y) const
+    {
+        return !contains(x, y) || m_cells[index(x, y)];
+    }
+
+    void set_blocked(int x, int y, bool blocked);
+
+    // The number of free cells
+    size_t free_count() const;
+
+    uint32_t index(int x, int y) const
+    {
+        return (uint32_t)y * m_width + x;
+    }
+
+    GridCell cell(uint32_t index) const
+    {
+        return {(int)(index % m_width), (int)(index / m_width)};
+    }
+
+    // The cell that contains the point, it can be outside of the grid
+    GridCell cell_at(const Point &p) const;
+
+    // The center of the cell in world coordinates
+    Point center(const GridCell &cell) const;
+
+    // True if the straight line between the centers of the two cells only crosses free cells. A line that
+    // passes exactly through a corner also needs both cells beside the corner to be free, the same rule that
+    // keeps diagonal moves from cutting corners.
+    bool line_of_sight(const GridCell &a, const GridCell &b) const;
+
+private:
+    int m_width;
+    int m_height;
+    double m_cell_size;
+    std::vector<uint8_t> m_cells;
+};
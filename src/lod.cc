@@ -0,0 +1,57 @@
+#include "lod.hh"
+
+#include <algorithm>
+
+LodScheduler::LodScheduler(double margin, double tier, int max_level)
+    : m_margin(margin), m_tier(tier), m_max_level(max_level)
+{
+}
+
+void LodScheduler::begin(const Rect &view)
+{
+    m_view = {{view.first.x - m_margin, view.first.y - m_margin},
+              {view.second.x + m_margin, view.second.y + m_margin}};
+    ++m_step;
+    m_near = 0;
+    m_far = 0;
+}
+
+int LodScheduler::steps(size_t index, const Object &obj)
+{
+    if (obj.is_sleeping() || !obj.is_active())
+    {
+        return 0;
+    }
+
+    const auto &rect = obj.world_rect();
+
+    if (overlaps(m_view, rect))
+    {
+        ++m_near;
+        return 1;
+    }
+
+    // Distance between the two rectangles along the axis where they are furthest apart
+    double dx = std::max(m_view.first.x - rect.second.x, rect.first.x - m_view.second.x);
+    double dy = std::max(m_view.first.y - rect.second.y, rect.first.y - m_view.second.y);
+    int level = std::min(m_max_level, 1 + (int)(std::max(dx, dy) / m_tier));
+    uint64_t interval = 1 << level;
+
+    if ((m_step + index) % interval == 0)
+    {
+        ++m_far;
+        return interval;
+    }
+
+    return 0;
+}
+
+int LodScheduler::near_count() const
+{
+    return m_near;
+}
+
+int LodScheduler::far_count() const
+{
+    return m_far;
+}
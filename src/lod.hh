@@ -0,0 +1,38 @@
+#pragma once
+
+#include "objects.hh"
+
+#include <cstdint>
+
+// Decides how often objects are ticked based on their distance from the camera. Objects that are in view, or
+// close to it, are ticked every step. Objects further away are ticked at a lower rate with a proportionally
+// larger step so that they still move at the same average speed. Sleeping objects are never ticked here, they
+// are only woken up by events.
+class LodScheduler
+{
+public:
+    // margin: how far outside of the view objects are still ticked every step
+    // tier:   the distance after which the tick interval doubles
+    // max_level: the tick interval is at most 2^max_level steps
+    LodScheduler(double margin = 100, double tier = 400, int max_level = 3);
+
+    // Start a new step. The view is the visible area in world coordinates.
+    void begin(const Rect &view);
+
+    // How many steps the object should advance during this step, zero if it should not be ticked at all. The
+    // index is used to spread the objects with the same tick interval evenly across the steps.
+    int steps(size_t index, const Object &obj);
+
+    // The number of objects that were ticked at full rate and at a reduced rate during the current step
+    int near_count() const;
+    int far_count() const;
+
+private:
+    double m_margin;
+    double m_tier;
+    int m_max_level;
+    Rect m_view;
+    uint64_t m_step = 0;
+    int m_near = 0;
+    int m_far = 0;
+};
@@ -4,13 +4,25 @@
 #include <exception>
 #include <vector>
 #include <algorithm>
-#include <sstream>
+#include <cstdio>
+#include <fstream>
 
 #include "common.hh"
+#include "arena.hh"
+#include "batch.hh"
 #include "graphics.hh"
 #include "objects.hh"
+#include "entities.hh"
 #include "world.hh"
 #include "events.hh"
+#include "lod.hh"
+#include "pick.hh"
+#include "profiler.hh"
+#include "replay.hh"
+#include "scene.hh"
+#include "generator.hh"
+#include "grid.hh"
+#include "planner.hh"
 
 using namespace std;
 using chrono::duration_cast;
@@ -23,93 +35,446 @@ static constexpr int WINDOW_WIDTH = 800;
 static constexpr int WINDOW_HEIGHT = 600;
 static constexpr int FRAMERATE = 120;
 
+// How long to block waiting for input when nothing in the world is moving
+static constexpr int IDLE_TIMEOUT_MS = 500;
+
+// The profiler HUD is refreshed every this many frames
+static constexpr int PROFILER_HUD_INTERVAL = 30;
+static constexpr int PROFILER_FONT_SIZE = 16;
+static const char *PROFILER_CSV = "profile.csv";
+static const char *PROFILER_TRACE = "profile.json";
+
+// The debug paths are planned on a grid with cells of at least this size, or larger ones if the world would
+// need more than DEBUG_GRID_MAX_CELLS of them on a side
+static constexpr double DEBUG_GRID_CELL = 25;
+static constexpr int DEBUG_GRID_MAX_CELLS = 512;
+
+// How many pixels the camera moves with the arrow keys
+static constexpr double CAMERA_SPEED = 20;
+
+// How far the mouse must move in pixels before a click becomes a drag
+static constexpr double DRAG_THRESHOLD = 4;
+
 static const std::string FONT_NAME = "fonts/pixeldroidMenuRegular.ttf";
 static const Color FONT_COLOR = COLOR_WHITE;
 static const int FONT_SIZE = 25;
 
-class Program
+struct Options
+{
+    // Run without a window, only simulating the world
+    bool headless = false;
+
+    // File where the input events are recorded
+    std::string record;
+
+    // File from which the input events are replayed
+    std::string replay;
+
+    // File where the per-tick timings of a replay are written as CSV
+    std::string timings;
+
+    // Scene file that is loaded at startup
+    std::string scene;
+
+    // File where the scene is saved with F5
+    std::string save = "scene.navs";
+
+    // Generate a scene instead of loading one
+    bool generate = false;
+    GeneratorOptions generator;
+
+    // How many ticks a headless run lasts, zero for the length of the replay
+    uint64_t ticks = 0;
+
+    // File with the scenarios of a batch run, the scenarios are run without a window
+    std::string batch;
+
+    // File where the results of the batch run are written as CSV
+    std::string report = "batch.csv";
+
+    // The number of threads for the batch run, zero for one per core
+    size_t threads = 0;
+};
+
+static const char *USAGE = R"(Usage: navigator [OPTIONS]
+
+  --help          Show this help
+
+  --record FILE   Record the input events into FILE
+  --replay FILE   Replay the input events from FILE
+  --timings FILE  Write the per-tick timings of a replay into FILE
+  --scene FILE    Load the scene from FILE
+  --save FILE     Save the scene into FILE when F5 is pressed (default: scene.navs)
+  --headless      Run without a window, requires --replay or --ticks
+  --ticks N       Stop a headless run after N ticks
+
+Scene generation:
+  --generate LAYOUT  Generate a scene, LAYOUT is one of: random, maze, corridors
+  --seed N           Random seed (default: 1)
+  --agents N         Number of navigators (default: 100)
+  --walls N          Number of polygons in the random layout (default: 200)
+  --width N          Width of the generated world (default: 4000)
+  --height N         Height of the generated world (default: 4000)
+  --cell N           Maze cell size or corridor width (default: 150)
+
+Batch runs:
+  --batch FILE    Run the scenarios in FILE on all cores and exit, see batch.hh for the format
+  --report FILE   Write the results of the batch run into FILE (default: batch.csv)
+  --threads N     Number of threads for the batch run (default: one per core)
+)";
+
+Options parse_options(int argc, char **argv)
+{
+    Options options;
+
+    for (int i = 1; i < argc; i++)
+    {
+        std::string arg = argv[i];
+
+        auto value = [&]()
+        {
+            if (i + 1 >= argc)
+            {
+                throw Error("Missing value for " + arg + "\n" + USAGE);
+            }
+
+            return std::string(argv[++i]);
+        };
+
+        auto number = [&]()
+        {
+            auto str = value();
+
+            try
+            {
+                return std::stod(str);
+            }
+            catch (const std::exception &e)
+            {
+                throw Error("Invalid value for " + arg + ": " + str);
+            }
+        };
+
+        // A whole number in the range [lo, hi], checked before it's converted so that huge values can't wrap
+        auto integer = [&](int lo, int hi)
+        {
+            double result = number();
+
+            if (!(result >= lo && result <= hi) || result != (int)result)
+            {
+                throw Error(arg + " must be a whole number between " + std::to_string(lo) + " and " +
+                            std::to_string(hi) + ", got " + argv[i]);
+            }
+
+            return (int)result;
+        };
+
+        if (arg == "--help")
+        {
+            cout << USAGE;
+            exit(0);
+        }
+        else if (arg == "--record")
+        {
+            options.record = value();
+        }
+        else if (arg == "--replay")
+        {
+            options.replay = value();
+        }
+        else if (arg == "--timings")
+        {
+            options.timings = value();
+        }
+        else if (arg == "--scene")
+        {
+            options.scene = value();
+        }
+        else if (arg == "--save")
+        {
+            options.save = value();
+        }
+        else if (arg == "--headless")
+        {
+            options.headless = true;
+        }
+        else if (arg == "--ticks")
+        {
+            options.ticks = number();
+        }
+        else if (arg == "--generate")
+        {
+            options.generate = true;
+            options.generator.layout = GeneratorOptions::parse_layout(value());
+        }
+        else if (arg == "--seed")
+        {
+            auto str = value();
+
+            // Seeds use all 64 bits, a double would round the large ones
+            try
+            {
+                size_t end = 0;
+                options.generator.seed = std::stoull(str, &end);
+
+                if (end != str.size() || str.find('-') != std::string::npos)
+                {
+                    throw std::invalid_argument(str);
+                }
+            }
+            catch (const std::exception &e)
+            {
+                throw Error("Invalid value for " + arg + ": " + str);
+            }
+        }
+        else if (arg == "--agents")
+        {
+            options.generator.agents = integer(0, GeneratorOptions::MAX_OBJECTS);
+        }
+        else if (arg == "--walls")
+        {
+            options.generator.walls = integer(0, GeneratorOptions::MAX_OBJECTS);
+        }
+        else if (arg == "--width")
+        {
+            options.generator.width = number();
+        }
+        else if (arg == "--height")
+        {
+            options.generator.height = number();
+        }
+        else if (arg == "--cell")
+        {
+            options.generator.cell = number();
+        }
+        else if (arg == "--batch")
+        {
+            options.batch = value();
+        }
+        else if (arg == "--report")
+        {
+            options.report = value();
+        }
+        else if (arg == "--threads")
+        {
+            options.threads = number();
+        }
+        else
+        {
+            throw Error("Unknown option: " + arg + "\n" + USAGE);
+        }
+    }
+
+    if (options.headless && options.replay.empty() && options.ticks == 0)
+    {
+        throw Error(std::string("--headless requires --replay or --ticks\n") + USAGE);
+    }
+
+    return options;
+}
+
+class Program : public EventListener<Program>
 {
 public:
-    Program()
+    Program(World &world, const Options &options)
+        : EventListener(world.events()), m_world(world), m_options(options), m_picker(world)
     {
-        if (SDL_Init(SDL_INIT_EVERYTHING) < 0)
+        if (SDL_Init(m_options.headless ? SDL_INIT_EVENTS : SDL_INIT_EVERYTHING) < 0)
         {
             throw Error("SDL init failed");
         }
 
         Text::init();
+        Profiler::register_thread();
 
-        m_window = SDL_CreateWindow("Navigator", SDL_WINDOWPOS_CENTERED, SDL_WINDOWPOS_CENTERED, 800, 600, 0);
-
-        if (!m_window)
+        if (m_options.headless)
         {
-            throw Error("Window init failed");
+            // Objects still need a renderer for their textures, render them into a surface that's never shown
+            m_surface = SDL_CreateRGBSurfaceWithFormat(0, WINDOW_WIDTH, WINDOW_HEIGHT, 32, SDL_PIXELFORMAT_RGBA8888);
+
+            if (!m_surface)
+            {
+                throw Error("Surface init failed");
+            }
+
+            m_renderer = SDL_CreateSoftwareRenderer(m_surface);
         }
+        else
+        {
+            m_window = SDL_CreateWindow("Navigator", SDL_WINDOWPOS_CENTERED, SDL_WINDOWPOS_CENTERED, WINDOW_WIDTH, WINDOW_HEIGHT, 0);
+
+            if (!m_window)
+            {
+                throw Error("Window init failed");
+            }
+
+            m_renderer = SDL_CreateRenderer(m_window, -1, SDL_RENDERER_ACCELERATED | SDL_RENDERER_PRESENTVSYNC | SDL_RENDERER_TARGETTEXTURE);
 
-        m_renderer = SDL_CreateRenderer(m_window, -1, SDL_RENDERER_ACCELERATED | SDL_RENDERER_PRESENTVSYNC | SDL_RENDERER_TARGETTEXTURE);
+            SDL_RendererInfo info{};
+
+            if (m_renderer && SDL_GetRendererInfo(m_renderer, &info) == 0)
+            {
+                m_vsync = info.flags & SDL_RENDERER_PRESENTVSYNC;
+            }
+        }
 
         if (!m_renderer)
         {
             throw Error("Renderer init failed");
         }
 
-        m_mouse_label = std::make_unique<Text>(m_renderer);
-
-        SDL_RenderGetViewport(m_renderer, &m_camera);
-
-        EventGenerator::add(this, SDL_QUIT, [this](const auto &event)
-                            { m_running = false; });
+        if (!m_options.record.empty())
+        {
+            m_recorder = std::make_unique<EventRecorder>(m_options.record);
+        }
 
-        EventGenerator::add(this, SDL_MOUSEMOTION, [this](const auto &event)
-                            { on_mouse_move(event); });
+        if (!m_options.replay.empty())
+        {
+            m_player = std::make_unique<EventPlayer>(m_options.replay);
+        }
 
-        EventGenerator::add(this, SDL_MOUSEWHEEL, [this](const auto &event)
-                            { on_mouse_wheel(event); });
+        if (!m_options.scene.empty())
+        {
+            SceneFile scene(m_options.scene);
+            load_scene(scene.view());
+        }
 
-        EventGenerator::add(this, SDL_KEYDOWN, [this](const auto &event)
-                            { on_keydown(event); });
+        if (m_options.generate)
+        {
+            auto scene = generate_scene(m_options.generator);
+            load_scene(scene.view());
+        }
 
-        EventGenerator::add(this, SDL_MOUSEBUTTONUP, [this](const auto &event)
-                            { on_mousebuttonup(event); });
+        m_mouse_label = std::make_unique<Text>(m_renderer);
+        m_profiler_hud = std::make_unique<Text>(m_renderer);
+        m_profiler_hud->set_position({10, 10});
+
+        SDL_Rect viewport;
+        SDL_RenderGetViewport(m_renderer, &viewport);
+        m_camera.set_screen_size(viewport.w, viewport.h);
+
+        listen<&Program::on_quit>(SDL_QUIT);
+        listen<&Program::on_mouse_move>(SDL_MOUSEMOTION);
+        listen<&Program::on_lasso_sample>(SDL_MOUSEMOTION, true);
+        listen<&Program::on_mouse_wheel>(SDL_MOUSEWHEEL);
+        listen<&Program::on_keydown>(SDL_KEYDOWN);
+        listen<&Program::on_mousebuttondown>(SDL_MOUSEBUTTONDOWN);
+        listen<&Program::on_mousebuttonup>(SDL_MOUSEBUTTONUP);
     }
 
     ~Program()
     {
+        m_objects.clear();
+        m_walls.clear();
+        m_mouse_label.reset();
+        m_profiler_hud.reset();
+        TextureCache::clear();
+        Text::finish();
+
         SDL_DestroyRenderer(m_renderer);
+
+        if (m_surface)
+        {
+            SDL_FreeSurface(m_surface);
+        }
+
         SDL_DestroyWindow(m_window);
-        Text::finish();
         SDL_Quit();
     }
 
+    void load_scene(const SceneView &scene)
+    {
+        create_entities(m_world, m_renderer, scene, m_walls, m_objects);
+    }
+
+    void save_scene(const std::string &filename) const
+    {
+        SceneData scene;
+
+        for (const auto &w : m_walls)
+        {
+            scene.add_wall(w->points());
+        }
+
+        for (const auto &o : m_objects)
+        {
+            scene.add_agent(o->position(), o->rotation(), o->is_active(), o->is_collision_enabled());
+        }
+
+        ::save_scene(filename, scene.view());
+        cout << "Saved scene to " << filename << endl;
+    }
+
     void on_mouse_move(const SDL_Event &event)
     {
-        m_mouse.x = event.motion.x;
-        m_mouse.y = event.motion.y;
+        m_mouse_screen.x = event.motion.x;
+        m_mouse_screen.y = event.motion.y;
+        update_mouse();
+    }
+
+    // The lasso needs every mouse motion event, not only the last one of the frame
+    void on_lasso_sample(const SDL_Event &event)
+    {
+        if (!m_dragging)
+        {
+            return;
+        }
+
+        Point screen(event.motion.x, event.motion.y);
+        auto d = screen - m_drag_start;
+        m_drag_moved = m_drag_moved || d.dot(d) > DRAG_THRESHOLD * DRAG_THRESHOLD;
+
+        if (m_lasso_mode)
+        {
+            Point world = m_camera.to_world(screen);
+            auto step = world - m_lasso.back();
+
+            // Skip tiny movements to keep the polygon small
+            if (step.dot(step) * m_camera.zoom() * m_camera.zoom() > DRAG_THRESHOLD * DRAG_THRESHOLD)
+            {
+                m_lasso.push_back(world);
+            }
+        }
+    }
+
+    // Updates the world position of the mouse, needed whenever the mouse or the camera moves
+    void update_mouse()
+    {
+        m_mouse = m_camera.to_world(m_mouse_screen);
 
-        std::ostringstream ss;
-        ss << "X: " << m_mouse.x << " Y: " << m_mouse.y;
+        char buf[64];
+        snprintf(buf, sizeof(buf), "X: %d Y: %d", (int)m_mouse.x, (int)m_mouse.y);
 
-        m_mouse_label->set_text(ss.str(), FONT_NAME, FONT_COLOR, FONT_SIZE);
-        auto p = m_mouse;
+        m_mouse_label->set_text(buf, FONT_NAME, FONT_COLOR, FONT_SIZE);
+        auto p = m_mouse_screen;
         p += Point(0, -20);
         m_mouse_label->set_position(p);
+
+        m_picker.update(m_mouse);
+    }
+
+    void on_quit(const SDL_Event &event)
+    {
+        m_running = false;
     }
 
     void on_mouse_wheel(const SDL_Event &event)
     {
-        for (const auto &o : m_objects)
+        bool found = false;
+
+        // The objects may have moved under the mouse since the last mouse event
+        for (auto o : m_picker.update(m_mouse))
         {
-            if (o->is_inside(m_mouse))
-            {
-                if (event.wheel.y > 0)
-                {
-                    o->set_rotation(o->rotation() + 5);
-                }
-                else if (event.wheel.y < 0)
-                {
-                    o->set_rotation(o->rotation() - 5);
-                }
-            }
+            found = true;
+
+            // Wheel events are merged, y is the sum of all the steps during the frame
+            o->set_rotation(o->rotation() + 5 * event.wheel.y);
+        }
+
+        if (!found && event.wheel.y != 0)
+        {
+            m_camera.zoom_at(m_mouse_screen, pow(1.1, event.wheel.y));
+            update_mouse();
         }
     }
 
@@ -118,202 +483,395 @@ public:
         switch (event.key.keysym.sym)
         {
         case SDLK_LEFT:
-            m_camera.x -= 1;
+            m_camera.pan({-CAMERA_SPEED, 0});
+            update_mouse();
             break;
         case SDLK_RIGHT:
-            m_camera.x += 1;
+            m_camera.pan({CAMERA_SPEED, 0});
+            update_mouse();
             break;
         case SDLK_UP:
-            m_camera.y += 1;
+            m_camera.pan({0, -CAMERA_SPEED});
+            update_mouse();
             break;
         case SDLK_DOWN:
-            m_camera.y -= 1;
+            m_camera.pan({0, CAMERA_SPEED});
+            update_mouse();
             break;
 
         case SDLK_x:
-            if (!m_current.empty())
-            {
-                for (auto a : m_current)
-                {
-                    a->set_selected(false);
-                }
-
-                auto fn = [&](const auto &o)
-                { return m_current.count(o.get()); };
-
-                m_objects.erase(std::remove_if(m_objects.begin(), m_objects.end(), fn));
-                m_current.clear();
-            }
+            delete_selected();
             break;
 
         case SDLK_z:
-            for (auto a : m_current)
+            for (auto i : m_current)
             {
-                a->set_collision_enabled(!a->is_collision_enabled());
+                m_objects[i]->set_collision_enabled(!m_objects[i]->is_collision_enabled());
             }
             break;
 
         case SDLK_v:
-            for (auto a : m_current)
+            for (auto i : m_current)
+            {
+                m_objects[i]->set_active(!m_objects[i]->is_active());
+            }
+            break;
+
+        case SDLK_g:
+            for (auto i : m_current)
             {
-                a->set_active(!a->is_active());
+                m_objects[i]->set_goal(m_mouse);
             }
             break;
 
         case SDLK_1:
-            m_objects.push_back(Navigator::create(m_renderer));
+            m_objects.push_back(Navigator::create(m_world, m_renderer));
             m_objects.back()->set_position({m_mouse.x, m_mouse.y});
             break;
 
         case SDLK_2:
-            m_walls.push_back(Wall::create(m_renderer, m_selection));
+            m_walls.push_back(Wall::create(m_world, m_renderer, m_selection));
             m_selection.clear();
             break;
 
+#ifdef NAVIGATOR_PROFILER
+        case SDLK_p:
+            m_show_profiler = !m_show_profiler;
+            m_profiler_frames = 0;
+            m_profiler_hud->set_text("", FONT_NAME, FONT_COLOR, PROFILER_FONT_SIZE);
+            break;
+
+        // A failed write is reported and the program keeps running
+        case SDLK_F6:
+            try
+            {
+                Profiler::write_csv(PROFILER_CSV);
+                cout << "Wrote per-frame times of the last " << Profiler::HISTORY << " frames into " << PROFILER_CSV
+                     << endl;
+            }
+            catch (const Error &e)
+            {
+                cout << e.what() << endl;
+            }
+            break;
+
+        case SDLK_F7:
+            try
+            {
+                Profiler::write_trace(PROFILER_TRACE);
+                cout << "Wrote the trace of the last frames into " << PROFILER_TRACE << endl;
+            }
+            catch (const Error &e)
+            {
+                cout << e.what() << endl;
+            }
+            break;
+#endif
+
+        case SDLK_b:
+            m_batched = !m_batched;
+            cout << "Rendering " << (m_batched ? "in batches" : "with textures") << endl;
+            break;
+
+        case SDLK_c:
+            m_show_contacts = !m_show_contacts;
+            cout << "Contact overlay " << (m_show_contacts ? "enabled" : "disabled") << endl;
+            break;
+
+        case SDLK_F1:
+        case SDLK_F2:
+        case SDLK_F3:
+        {
+            auto layer = static_cast<DebugDraw::Layer>(event.key.keysym.sym - SDLK_F1);
+            m_debug.set_enabled(layer, !m_debug.is_enabled(layer));
+            cout << "Debug layer " << DebugDraw::name(layer) << (m_debug.is_enabled(layer) ? " enabled" : " disabled") << endl;
+        }
+        break;
+
+        case SDLK_F5:
+            save_scene(m_options.save);
+            break;
+
         case SDLK_ESCAPE:
             m_running = false;
             break;
         }
     }
 
+    void on_mousebuttondown(const SDL_Event &event)
+    {
+        if (event.button.button == SDL_BUTTON_LEFT)
+        {
+            // Dragging with shift held draws a lasso, otherwise a box
+            m_dragging = true;
+            m_drag_moved = false;
+            m_lasso_mode = m_world.events().modifiers() & KMOD_SHIFT;
+            m_drag_start = m_mouse_screen;
+            m_lasso.clear();
+            m_lasso.push_back(m_mouse);
+        }
+    }
+
     void on_mousebuttonup(const SDL_Event &event)
     {
         if (event.button.button == SDL_BUTTON_LEFT)
         {
+            // A lasso can end where it started, it's a drag if the mouse moved far enough at any point
+            bool dragged = m_dragging && m_drag_moved;
+            m_dragging = false;
+
+            if (dragged)
+            {
+                select_area();
+                return;
+            }
+
             bool found = false;
 
-            for (const auto &o : m_objects)
+            for (auto obj : m_picker.update(m_mouse))
             {
-                if (o->is_active() && o->is_inside(m_mouse))
+                auto o = dynamic_cast<Navigator *>(obj);
+
+                if (o && o->is_active())
                 {
                     found = true;
 
-                    if (m_current.count(o.get()))
-                    {
-                        o->set_selected(false);
-                        m_current.erase(o.get());
-                    }
-                    else
+                    if (!o->is_selected() && (m_world.events().modifiers() & KMOD_CTRL) == 0)
                     {
-                        if ((SDL_GetModState() & KMOD_CTRL) == 0)
-                        {
-                            for (auto a : m_current)
-                            {
-                                a->set_selected(false);
-                            }
-
-                            m_current.clear();
-                        }
-
-                        o->set_selected(true);
-                        m_current.insert(o.get());
+                        clear_selection();
                     }
+
+                    o->set_selected(!o->is_selected());
+                    update_selection();
                     break;
                 }
             }
 
             if (!found)
             {
-                for (auto a : m_current)
-                {
-                    a->set_selected(false);
-                }
-
-                m_current.clear();
-
+                clear_selection();
                 m_selection.push_back(m_mouse);
             }
         }
         else if (event.button.button == SDL_BUTTON_RIGHT)
         {
-            for (auto a : m_current)
+            clear_selection();
+            m_selection.clear();
+        }
+    }
+
+    // Selects the navigators inside the dragged box or lasso
+    void select_area()
+    {
+        if ((m_world.events().modifiers() & KMOD_CTRL) == 0)
+        {
+            clear_selection();
+        }
+
+        m_found.clear();
+
+        if (m_lasso_mode)
+        {
+            m_picker.find_in_polygon(m_lasso, m_found);
+        }
+        else
+        {
+            Point a = m_camera.to_world(m_drag_start);
+            Rect rect{{min(a.x, m_mouse.x), min(a.y, m_mouse.y)}, {max(a.x, m_mouse.x), max(a.y, m_mouse.y)}};
+            m_picker.find_in_rect(rect, m_found);
+        }
+
+        for (auto obj : m_found)
+        {
+            auto o = dynamic_cast<Navigator *>(obj);
+
+            if (o && o->is_active())
             {
-                a->set_selected(false);
+                o->set_selected(true);
             }
+        }
 
-            m_current.clear();
-            m_selection.clear();
+        update_selection();
+    }
+
+    // Rebuilds the indices of the selected navigators
+    void update_selection()
+    {
+        m_current.clear();
+
+        for (size_t i = 0; i < m_objects.size(); i++)
+        {
+            if (m_objects[i]->is_selected())
+            {
+                m_current.push_back(i);
+            }
         }
     }
 
+    void clear_selection()
+    {
+        for (auto i : m_current)
+        {
+            m_objects[i]->set_selected(false);
+        }
+
+        m_current.clear();
+    }
+
+    void delete_selected()
+    {
+        auto fn = [&](const auto &o)
+        { return o->is_selected(); };
+
+        m_objects.erase(std::remove_if(m_objects.begin(), m_objects.end(), fn), m_objects.end());
+        m_current.clear();
+    }
+
     void poll_event()
     {
+        pump_events();
+        tick();
+    }
+
+    void pump_events()
+    {
+        PROFILE_SCOPE("events");
         SDL_Event event;
 
         while (SDL_PollEvent(&event))
         {
-            EventGenerator::handle_event(event);
+            if (m_player)
+            {
+                // Live input is ignored during a replay, only closing the window is allowed
+                m_running = m_running && event.type != SDL_QUIT;
+                continue;
+            }
+
+            if (m_recorder)
+            {
+                m_recorder->record(m_tick, event, SDL_GetModState());
+            }
+
+            // Any input can change what's on the screen, e.g. the mouse label or the hover state
+            m_world.events().queue(event, SDL_GetModState());
+            m_ui_dirty = true;
         }
 
-        for (const auto &o : m_objects)
+        if (m_player)
         {
-            if (o->is_active())
+            EventPlayer::Event recorded;
+
+            while (m_player->next(m_tick, recorded))
             {
-                o->tick();
+                m_world.events().queue(recorded.event, recorded.modifiers);
+                m_ui_dirty = true;
             }
         }
+
+        // The motion and wheel events of the whole frame are handled once
+        m_world.events().flush();
     }
 
-    void render()
+    void tick()
     {
-        SDL_SetRenderDrawColor(m_renderer, 50, 50, 50, 255);
-        SDL_RenderClear(m_renderer);
+        PROFILE_SCOPE("tick");
+        m_world.clear_contacts();
 
-        for (const auto &w : m_walls)
+        // Nothing allocated from the scratch arena lives past the tick that allocated it
+        Arena::scratch().reset();
+        m_lod.begin(m_camera.view());
+        m_awake = 0;
+
+        // A walk over the contiguous registry of the world. The slot of the handle stays the same for the
+        // lifetime of the object unlike its position in the registry, it keeps the reduced rate ticks evenly spread.
+        for (Object *o : m_world.objects())
         {
-            w->render(m_renderer);
+            if (o->mobility() == Object::Mobility::STATIC)
+            {
+                continue;
+            }
+
+            if (int steps = m_lod.steps(o->handle().index, *o))
+            {
+                o->tick(steps);
+            }
+
+            if (o->is_active() && !o->is_sleeping())
+            {
+                ++m_awake;
+            }
         }
 
-        for (const auto &l : m_objects)
+        if (m_recorder)
         {
-            l->render(m_renderer);
+            m_recorder->set_tick(m_tick);
+        }
 
-            for (auto line : l->lines())
-            {
-                int collisions = 0;
+        ++m_tick;
+    }
 
-                for (const auto &r : m_objects)
-                {
-                    if (r.get() == l.get())
-                    {
-                        continue;
-                    }
+    void render()
+    {
+        PROFILE_SCOPE("render");
 
-                    auto [collided, points] = r->get_collisions(line);
+        SDL_SetRenderDrawColor(m_renderer, 50, 50, 50, 255);
+        SDL_RenderClear(m_renderer);
 
-                    if (collided)
-                    {
-                        ++collisions;
-
-                        for (auto p : points)
-                        {
-                            SDL_Rect rect;
-                            rect.w = 10;
-                            rect.h = 10;
-                            rect.x = p.x - 5;
-                            rect.y = p.y - 5;
-
-                            SDL_SetRenderDrawColor(m_renderer, 255, 0, 0, 255);
-                            SDL_RenderFillRect(m_renderer, &rect);
-                        }
-                    }
-                }
+        // Only the objects in view are drawn
+        m_visible.clear();
+        m_world.find(m_camera.view(), m_visible);
 
-                // SDL_RenderSetViewport(m_renderer, &m_camera);
+        if (m_batched)
+        {
+            m_batch.clear();
 
-                if (collisions)
+            for (auto o : m_visible)
+            {
+                if (auto r = dynamic_cast<Renderable *>(o))
                 {
-                    SDL_SetRenderDrawColor(m_renderer, 0, 0, 255, 255);
+                    r->append(m_batch, m_camera);
                 }
-                else
+            }
+
+            m_batch.draw(m_renderer);
+        }
+        else
+        {
+            for (auto o : m_visible)
+            {
+                if (auto r = dynamic_cast<Renderable *>(o))
                 {
-                    SDL_SetRenderDrawColor(m_renderer, 0, 255, 0, 255);
+                    r->render(m_renderer, m_camera);
                 }
             }
         }
 
+        if (m_show_contacts)
+        {
+            // The contacts found by the last tick, drawn as small squares
+            m_overlay.clear();
+
+            for (const auto &c : m_world.contacts())
+            {
+                auto p = m_camera.to_screen(c.point);
+                m_overlay.add_line(p - Point{5, 0}, p + Point{5, 0}, 10, COLOR_RED);
+            }
+
+            m_overlay.draw(m_renderer);
+        }
+
+        update_debug_cells();
+        update_debug_paths();
+        m_debug.draw(m_renderer, m_camera);
+
+        if (m_dragging)
+        {
+            draw_drag();
+        }
+
         for (auto p : m_selection)
         {
+            p = m_camera.to_screen(p);
             SDL_Rect rect;
             rect.w = 4;
             rect.h = 4;
@@ -324,63 +882,423 @@ public:
             SDL_RenderFillRect(m_renderer, &rect);
         }
 
-        m_mouse_label->render(m_renderer);
+        m_mouse_label->render(m_renderer, m_camera);
+
+        if (m_show_profiler)
+        {
+            m_profiler_hud->render(m_renderer, m_camera);
+        }
 
         SDL_RenderPresent(m_renderer);
     }
 
+    void draw_drag()
+    {
+        Color color{50, 125, 200};
+        m_overlay.clear();
+
+        if (m_lasso_mode)
+        {
+            for (size_t i = 1; i < m_lasso.size(); i++)
+            {
+                m_overlay.add_line(m_camera.to_screen(m_lasso[i - 1]), m_camera.to_screen(m_lasso[i]), 1, color);
+            }
+
+            m_overlay.add_line(m_camera.to_screen(m_lasso.back()), m_mouse_screen, 1, color);
+        }
+        else
+        {
+            Point a = m_drag_start;
+            Point c = m_mouse_screen;
+            Point b{c.x, a.y};
+            Point d{a.x, c.y};
+            m_overlay.add_line(a, b, 1, color);
+            m_overlay.add_line(b, c, 1, color);
+            m_overlay.add_line(c, d, 1, color);
+            m_overlay.add_line(d, a, 1, color);
+        }
+
+        m_overlay.draw(m_renderer);
+    }
+
+    // Rebuilds the spatial index layer if it's shown and the objects have moved since it was last built
+    void update_debug_cells()
+    {
+        if (!m_debug.is_enabled(DebugDraw::Layer::SPATIAL_CELLS) || m_debug_cells_changes == m_world.changes())
+        {
+            return;
+        }
+
+        for (auto mobility : {Object::Mobility::STATIC, Object::Mobility::DYNAMIC})
+        {
+            bool is_static = mobility == Object::Mobility::STATIC;
+            Color color = is_static ? Color{90, 90, 200} : Color{200, 200, 90};
+
+            m_cells.clear();
+            m_world.index_cells(mobility, m_cells);
+            m_debug.begin(DebugDraw::Layer::SPATIAL_CELLS, is_static ? &m_walls : (void *)&m_objects);
+
+            for (const auto &cell : m_cells)
+            {
+                m_debug.add_rect(cell, color);
+            }
+
+            m_debug.end();
+        }
+
+        m_debug_cells_changes = m_world.changes();
+    }
+
+    // Plans the paths of the selected navigators that are on the way to a goal if the paths or the expansions
+    // are shown. The navigators still steer straight at their goals, this shows what Lazy Theta* would do on a
+    // grid built from the walls. Replanned when something has moved or the selection has changed.
+    void update_debug_paths()
+    {
+        if (!m_debug.is_enabled(DebugDraw::Layer::PATHS) && !m_debug.is_enabled(DebugDraw::Layer::EXPANSIONS))
+        {
+            return;
+        }
+
+        if (m_debug_paths_changes == m_world.changes() && m_debug_paths_selection == m_current)
+        {
+            return;
+        }
+
+        // The walls don't move, the grid only needs to be rebuilt when one is added
+        if (!m_debug_planner || m_debug_grid_walls != m_walls.size())
+        {
+            Point size{1, 1};
+
+            for (const auto &w : m_walls)
+            {
+                size.x = std::max(size.x, w->world_rect().second.x);
+                size.y = std::max(size.y, w->world_rect().second.y);
+            }
+
+            double cell = std::max(DEBUG_GRID_CELL, std::max(size.x, size.y) / DEBUG_GRID_MAX_CELLS);
+            m_debug_planner.reset();
+            m_debug_grid = std::make_unique<OccupancyGrid>(OccupancyGrid::from_walls(m_world, size.x, size.y, cell));
+            m_debug_planner = std::make_unique<GridPlanner>(*m_debug_grid, GridPlanner::Algorithm::LAZY_THETA_STAR);
+            m_debug_grid_walls = m_walls.size();
+        }
+
+        PROFILE_SCOPE("plan");
+        const auto &grid = *m_debug_grid;
+        double cell = grid.cell_size();
+        std::vector<const void *> owners;
+
+        for (auto i : m_current)
+        {
+            const auto &n = *m_objects[i];
+
+            if (n.goal_state() != Navigator::GoalState::MOVING)
+            {
+                continue;
+            }
+
+            const auto &rect = n.world_rect();
+            auto start = grid.cell_at((rect.first + rect.second) * 0.5);
+            m_debug_planner->find_path(start, grid.cell_at(n.goal()), m_debug_path);
+
+            m_debug.begin(DebugDraw::Layer::PATHS, &n);
+
+            for (size_t k = 1; k < m_debug_path.size(); k++)
+            {
+                m_debug.add_line(grid.center(m_debug_path[k - 1]), grid.center(m_debug_path[k]), COLOR_GREEN);
+            }
+
+            m_debug.end();
+
+            m_debug_planner->expanded(m_debug_expanded);
+            m_debug.begin(DebugDraw::Layer::EXPANSIONS, &n);
+
+            for (const auto &c : m_debug_expanded)
+            {
+                m_debug.add_rect({{c.x * cell, c.y * cell}, {(c.x + 1) * cell, (c.y + 1) * cell}}, Color{200, 120, 40});
+            }
+
+            m_debug.end();
+            owners.push_back(&n);
+        }
+
+        // The navigators that are no longer selected or have stopped
+        for (auto *owner : m_debug_path_owners)
+        {
+            if (std::find(owners.begin(), owners.end(), owner) == owners.end())
+            {
+                m_debug.remove(DebugDraw::Layer::PATHS, owner);
+                m_debug.remove(DebugDraw::Layer::EXPANSIONS, owner);
+            }
+        }
+
+        m_debug_path_owners.swap(owners);
+        m_debug_paths_changes = m_world.changes();
+        m_debug_paths_selection = m_current;
+    }
+
+    void end_frame()
+    {
+#ifdef NAVIGATOR_PROFILER
+        Profiler::end_frame();
+
+        // The percentiles are only refreshed every now and then, they move slowly anyway
+        if (m_show_profiler && ++m_profiler_frames % PROFILER_HUD_INTERVAL == 0)
+        {
+            Profiler::summary(m_profiler_text);
+            m_profiler_hud->set_text(m_profiler_text, FONT_NAME, FONT_COLOR, PROFILER_FONT_SIZE);
+            m_ui_dirty = true;
+        }
+#endif
+    }
+
+    // Runs the replay as fast as possible without rendering anything
+    void run_headless()
+    {
+        if (m_player)
+        {
+            cout << "Replaying " << m_player->ticks() << " ticks from " << m_options.replay << endl;
+        }
+
+        cout << "Objects: " << m_objects.size() << " navigators, " << m_walls.size() << " walls" << endl;
+
+        while (m_running && !finished())
+        {
+            timed_poll_event();
+        }
+
+        report_timings();
+    }
+
+    // True if ticking the world does nothing until some input arrives
+    bool idle() const
+    {
+        return m_awake == 0 && !m_ui_dirty && !m_player && !m_options.ticks;
+    }
+
+    bool finished() const
+    {
+        if (m_options.ticks)
+        {
+            return m_tick >= m_options.ticks;
+        }
+
+        return m_player && m_player->done(m_tick);
+    }
+
+    void timed_poll_event()
+    {
+        auto start = Clock::now();
+        poll_event();
+        m_tick_times.push_back(Clock::now() - start);
+    }
+
+    void report_timings()
+    {
+        if (m_tick_times.empty())
+        {
+            return;
+        }
+
+        auto sorted = m_tick_times;
+        std::sort(sorted.begin(), sorted.end());
+
+        auto us = [](Clock::duration d)
+        {
+            return chrono::duration<double, std::micro>(d).count();
+        };
+
+        Clock::duration total{0};
+
+        for (auto d : sorted)
+        {
+            total += d;
+        }
+
+        cout << "Ticks: " << sorted.size() << endl;
+        cout << "Total: " << us(total) / 1000 << " ms" << endl;
+        cout << "Mean:  " << us(total) / sorted.size() << " us" << endl;
+        cout << "p50:   " << us(percentile(sorted, 0.5)) << " us" << endl;
+        cout << "p90:   " << us(percentile(sorted, 0.9)) << " us" << endl;
+        cout << "p99:   " << us(percentile(sorted, 0.99)) << " us" << endl;
+        cout << "Max:   " << us(sorted.back()) << " us" << endl;
+
+        if (!m_options.timings.empty())
+        {
+            std::ofstream out(m_options.timings);
+            out << "tick,us\n";
+
+            for (size_t i = 0; i < m_tick_times.size(); i++)
+            {
+                out << i << ',' << us(m_tick_times[i]) << '\n';
+            }
+        }
+    }
+
     void run()
     {
+        if (m_options.headless)
+        {
+            run_headless();
+            return;
+        }
+
         constexpr const milliseconds frame_time{1000 / FRAMERATE};
-        auto prev = Clock::now();
-        int frames = 0;
 
         cout << "Framerate: " << FRAMERATE << endl;
         cout << "ms per frame: " << frame_time.count() << endl;
 
-        while (m_running)
+        while (m_running && !finished())
         {
-            poll_event();
-            render();
+            auto start = Clock::now();
+            bool presented = false;
 
-            auto now = Clock::now();
-            auto loop_time = duration_cast<milliseconds>(now - prev);
-            auto time_left = frame_time - loop_time;
+            {
+                // The work done for the frame, without the time spent waiting for the next one
+                PROFILE_SCOPE("frame");
 
-            int frames_ms = duration_cast<milliseconds>(time_left).count();
+                if (m_player || m_options.ticks)
+                {
+                    timed_poll_event();
+                }
+                else
+                {
+                    poll_event();
+                }
+
+                // Only draw a new frame if something changed since the last one
+                if (m_ui_dirty || m_world.changes() != m_rendered_changes)
+                {
+                    render();
+                    m_ui_dirty = false;
+                    m_rendered_changes = m_world.changes();
+                    presented = true;
+                }
+            }
 
-            frames = 1000 / max(loop_time.count(), frame_time.count());
-            prev = now;
+            end_frame();
 
-            if (time_left.count() > 0)
+            if (idle())
+            {
+                // Nothing can change before the next event arrives
+                SDL_WaitEventTimeout(nullptr, IDLE_TIMEOUT_MS);
+            }
+            else if (!presented || !m_vsync)
             {
-                this_thread::sleep_for(time_left);
+                // With vsync, presenting the frame already waited for the display
+                auto time_left = frame_time - (Clock::now() - start);
+
+                if (time_left.count() > 0)
+                {
+                    this_thread::sleep_for(time_left);
+                }
             }
         }
+
+        report_timings();
     }
 
 private:
+    World &m_world;
+    Options m_options;
     SDL_Window *m_window{nullptr};
+    SDL_Surface *m_surface{nullptr};
     SDL_Renderer *m_renderer{nullptr};
-    SDL_Rect m_camera;
+    Camera m_camera{WINDOW_WIDTH, WINDOW_HEIGHT};
+    LodScheduler m_lod;
     bool m_running{true};
+    uint64_t m_tick{0};
+
+    // Frames are only drawn when the world or the UI has changed since the last one
+    bool m_vsync{false};
+    bool m_ui_dirty{true};
+    uint64_t m_rendered_changes{0};
+
+    // The number of objects that were awake after the last tick
+    size_t m_awake{0};
+
+    std::unique_ptr<EventRecorder> m_recorder;
+    std::unique_ptr<EventPlayer> m_player;
+    std::vector<Clock::duration> m_tick_times;
 
+    // Mouse position in world and screen coordinates
     Point m_mouse;
+    Point m_mouse_screen;
     std::unique_ptr<Text> m_mouse_label;
 
+    // Frame time percentiles, toggled with P
+    std::unique_ptr<Text> m_profiler_hud;
+    std::string m_profiler_text;
+    bool m_show_profiler{false};
+    int m_profiler_frames{0};
+
     std::vector<std::unique_ptr<Wall>> m_walls;
     std::vector<std::unique_ptr<Navigator>> m_objects;
 
+    // Tracks the objects under the mouse
+    Picker m_picker;
+
     std::vector<Point> m_selection;
 
-    std::set<Navigator *> m_current;
+    // Objects that were visible on the last frame
+    std::vector<Object *> m_visible;
+
+    // Whether the objects are drawn with one batch or with a texture for each object
+    bool m_batched{true};
+    Batch m_batch;
+
+    // Collision contacts of the last tick
+    bool m_show_contacts{true};
+    Batch m_overlay;
+
+    // Debug layers, toggled with F1-F3
+    DebugDraw m_debug;
+    uint64_t m_debug_cells_changes{0};
+    std::vector<Rect> m_cells;
+
+    // The planner behind the paths and expansions layers, created when one of them is first shown
+    std::unique_ptr<OccupancyGrid> m_debug_grid;
+    std::unique_ptr<GridPlanner> m_debug_planner;
+    size_t m_debug_grid_walls{0};
+    uint64_t m_debug_paths_changes{0};
+    std::vector<uint32_t> m_debug_paths_selection;
+    std::vector<const void *> m_debug_path_owners;
+    std::vector<GridCell> m_debug_path;
+    std::vector<GridCell> m_debug_expanded;
+
+    // Indices of the selected navigators in m_objects, in order
+    std::vector<uint32_t> m_current;
+    std::vector<Object *> m_found;
+
+    // Box or lasso selection, the lasso is in world coordinates
+    bool m_dragging{false};
+    bool m_drag_moved{false};
+    bool m_lasso_mode{false};
+    Point m_drag_start;
+    std::vector<Point> m_lasso;
 };
 
 int main(int argc, char **argv)
 {
     try
     {
-        Program program;
+        auto options = parse_options(argc, argv);
+
+        if (!options.batch.empty())
+        {
+            // Batch runs create worlds of their own and never open a window
+            std::ofstream report(options.report);
+
+            if (!report)
+            {
+                throw Error("Could not open " + options.report);
+            }
+
+            run_batch(load_batch(options.batch), options.threads, report);
+            return 0;
+        }
+
+        World world;
+        Program program(world, options);
         program.run();
     }
     catch (runtime_error err)
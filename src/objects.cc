@@ -1,19 +1,66 @@
 #include "objects.hh"
+#include "arena.hh"
+#include "world.hh"
 
 #include <cassert>
 #include <iostream>
 #include <algorithm>
-#include <set>
+#include <limits>
 
 namespace
 {
-    std::set<Object *> s_objects;
+    // Calls func with every point where the line crosses one of the lines
+    // Implements this
+    // https://stackoverflow.com/questions/563198/how-do-you-detect-where-two-line-segments-intersect/565282#565282
+    template <class Func>
+    void for_each_intersection(const Line *lines, size_t count, const Line &line, Func &&func)
+    {
+        const Point &p1 = line.first;
+        const Point &p2 = line.second;
+
+        auto check_intersection = [&](auto q1, auto q2)
+        {
+            auto r = p2 - p1;
+            auto s = q2 - q1;
+            auto rxs = r.cross(s);
+            auto qpxr = (q1 - p1).cross(r);
+            auto t = (q1 - p1).cross(s) / r.cross(s);
+            auto u = (q1 - p1).cross(r) / r.cross(s);
+
+            if (rxs == 0)
+            {
+                if (qpxr == 0)
+                {
+                    auto t0 = (q1 - p1).dot(r) / r.dot(r);
+                    auto t1 = t0 + s.dot(r) / r.dot(r);
+
+                    if ((t0 > 0 && t0 < 1) || (t1 > 0 && t1 < 1))
+                    {
+                        func(p1 + r * t);
+                    }
+                }
+                else
+                {
+                    return;
+                }
+            }
+
+            if (u >= 0.0 && u <= 1.0 && t >= 0.0 && t <= 1.0)
+            {
+                func(p1 + r * t);
+            }
+        };
+
+        for (size_t i = 0; i < count; i++)
+        {
+            check_intersection(lines[i].first, lines[i].second);
+        }
+    }
 }
 
-Object::Object(std::vector<Point> pts)
-    : m_bounds(std::move(pts))
+Object::Object(World &world, std::vector<Point> pts, Mobility mobility)
+    : m_world(world), m_bounds(std::move(pts)), m_mobility(mobility)
 {
-    s_objects.insert(this);
     Point center{0, 0};
     m_min = m_bounds.front();
     m_max = m_min;
@@ -30,11 +77,26 @@ Object::Object(std::vector<Point> pts)
 
     m_center.x = m_min.x + (m_max.x - m_min.x) / 2;
     m_center.y = m_min.y + (m_max.y - m_min.y) / 2;
+
+    m_world_rect = {m_min, m_max};
+    m_slot = m_world.index_of(m_mobility).insert(this, m_world_rect);
+    m_handle = m_world.add(this);
 }
 
 Object::~Object()
 {
-    s_objects.erase(this);
+    m_world.index_of(m_mobility).remove(m_slot);
+    m_world.remove(m_handle);
+}
+
+World &Object::world() const
+{
+    return m_world;
+}
+
+ObjectHandle Object::handle() const
+{
+    return m_handle;
 }
 
 void Object::set_collision_enabled(bool enabled)
@@ -44,6 +106,8 @@ void Object::set_collision_enabled(bool enabled)
 
     if (changed)
     {
+        ++m_world.m_changes;
+        wake();
         state_changed(ChangeType::COLLISION);
     }
 }
@@ -60,6 +124,8 @@ void Object::set_active(bool enabled)
 
     if (changed)
     {
+        ++m_world.m_changes;
+        wake();
         state_changed(ChangeType::ACTIVE);
     }
 }
@@ -69,6 +135,26 @@ bool Object::is_active() const
     return m_active;
 }
 
+Object::Mobility Object::mobility() const
+{
+    return m_mobility;
+}
+
+bool Object::is_sleeping() const
+{
+    return m_sleeping;
+}
+
+void Object::sleep()
+{
+    m_sleeping = m_mobility == Mobility::DYNAMIC;
+}
+
+void Object::wake()
+{
+    m_sleeping = false;
+}
+
 // X and Y position of the object in the world, [0, 0] is the center of the world.
 const Point &Object::position() const
 {
@@ -83,7 +169,11 @@ const Point &Object::center() const
 
 void Object::set_position(Point p)
 {
-    m_pos = p;
+    if (!(p == m_pos))
+    {
+        m_pos = p;
+        moved();
+    }
 }
 
 const std::vector<Point> &Object::bounds() const
@@ -99,7 +189,43 @@ double Object::rotation() const
 
 void Object::set_rotation(double d)
 {
-    m_dir = d;
+    if (d != m_dir)
+    {
+        m_dir = d;
+        moved();
+    }
+}
+
+void Object::moved()
+{
+    Point min{std::numeric_limits<double>::max(), std::numeric_limits<double>::max()};
+    Point max{std::numeric_limits<double>::lowest(), std::numeric_limits<double>::lowest()};
+
+    for (auto p : m_bounds)
+    {
+        p.rotate(rotation(), m_center);
+        p += position();
+        min.x = std::min(min.x, p.x);
+        min.y = std::min(min.y, p.y);
+        max.x = std::max(max.x, p.x);
+        max.y = std::max(max.y, p.y);
+    }
+
+    m_world_rect = {min, max};
+    m_world.index_of(m_mobility).update(m_slot, m_world_rect);
+    ++m_world.m_changes;
+
+    if (m_mobility == Mobility::DYNAMIC && !m_sleeping)
+    {
+        // Something moved near the sleeping objects, let them react to it on the next tick
+        m_world.m_dynamic.for_each(m_world_rect, [&](Object *o)
+                           {
+                               if (o->m_sleeping && overlaps(m_world_rect, o->m_world_rect))
+                               {
+                                   o->wake();
+                               }
+                           });
+    }
 }
 
 std::vector<Point> Object::points() const
@@ -130,6 +256,11 @@ std::pair<Point, Point> Object::bounding_rect() const
     return {m_min, m_max};
 }
 
+const Rect &Object::world_rect() const
+{
+    return m_world_rect;
+}
+
 std::vector<Line> Object::to_lines(const std::vector<Point> &pts) const
 {
     std::vector<Line> ln;
@@ -155,7 +286,9 @@ std::vector<Line> Object::scan_lines() const
         y_max = std::max(y_max, p.y);
     }
 
+    ArenaScope scope;
     auto lines = bounding_lines();
+    ScratchVector<Point> pts;
 
     std::vector<Line> ln;
 
@@ -167,7 +300,9 @@ std::vector<Line> Object::scan_lines() const
         l.second.x = 9e10;
         l.second.y = i;
 
-        auto [collided, pts] = get_collisions(lines, l);
+        pts.clear();
+        for_each_intersection(lines.data(), lines.size(), l, [&](const Point &p)
+                              { pts.push_back(p); });
 
         if (pts.size() == 1)
         {
@@ -197,83 +332,129 @@ std::vector<Line> Object::scan_lines() const
     return ln;
 }
 
-// Implements this
-// https://stackoverflow.com/questions/563198/how-do-you-detect-where-two-line-segments-intersect/565282#565282
 std::pair<bool, std::vector<Point>> Object::get_collisions(const std::vector<Line> &my_lines, const Line &line)
 {
-    const Point &p1 = line.first;
-    const Point &p2 = line.second;
     std::vector<Point> points;
+    for_each_intersection(my_lines.data(), my_lines.size(), line, [&](const Point &p)
+                          { points.push_back(p); });
+    return {!points.empty(), points};
+}
 
-    auto check_intersection = [&](auto q1, auto q2)
-    {
-        auto r = p2 - p1;
-        auto s = q2 - q1;
-        auto rxs = r.cross(s);
-        auto qpxr = (q1 - p1).cross(r);
-        auto t = (q1 - p1).cross(s) / r.cross(s);
-        auto u = (q1 - p1).cross(r) / r.cross(s);
-
-        if (rxs == 0)
-        {
-            if (qpxr == 0)
-            {
-                auto t0 = (q1 - p1).dot(r) / r.dot(r);
-                auto t1 = t0 + s.dot(r) / r.dot(r);
+std::pair<bool, std::vector<Point>> Object::get_collisions(const Line &line) const
+{
+    ArenaScope scope;
+    ScratchVector<Line> ln;
+    world_lines(ln);
 
-                if ((t0 > 0 && t0 < 1) || (t1 > 0 && t1 < 1))
-                {
-                    points.push_back({p1 + r * t});
-                }
-            }
-            else
-            {
-                return;
-            }
-        }
+    std::vector<Point> points;
+    for_each_intersection(ln.data(), ln.size(), line, [&](const Point &p)
+                          { points.push_back(p); });
+    return {!points.empty(), points};
+}
 
-        if (u >= 0.0 && u <= 1.0 && t >= 0.0 && t <= 1.0)
-        {
-            points.push_back({p1 + r * t});
-        }
-    };
+std::pair<bool, std::vector<Point>> Object::get_collisions(const Object &other) const
+{
+    ArenaScope scope;
+    ScratchVector<Line> mine;
+    ScratchVector<Line> theirs;
+    world_lines(mine);
+    other.world_lines(theirs);
 
-    for (auto l : my_lines)
+    std::vector<Point> points;
+
+    for (const auto &line : mine)
     {
-        check_intersection(l.first, l.second);
+        for_each_intersection(theirs.data(), theirs.size(), line, [&](const Point &p)
+                              { points.push_back(p); });
     }
 
     return {!points.empty(), points};
 }
 
-// Implements this
-// https://stackoverflow.com/questions/563198/how-do-you-detect-where-two-line-segments-intersect/565282#565282
-std::pair<bool, std::vector<Point>> Object::get_collisions(const Line &line) const
-{
-    return get_collisions(lines(), line);
-}
-
-std::pair<bool, std::vector<Point>> Object::get_collisions(const Object &other) const
+void Object::world_lines(ScratchVector<Line> &result) const
 {
-    bool rval = false;
-    std::vector<Point> points;
+    result.reserve(result.size() + m_bounds.size());
+    Point first;
+    Point prev;
 
-    for (const auto &line : lines())
+    for (size_t i = 0; i < m_bounds.size(); i++)
     {
-        auto [collided, pts] = other.get_collisions(line);
+        Point p = m_bounds[i];
+        p.rotate(rotation(), m_center);
+        p += position();
 
-        if (collided)
+        if (i == 0)
         {
-            rval = true;
-            points.insert(points.end(), pts.begin(), pts.end());
+            first = p;
         }
+        else
+        {
+            result.emplace_back(prev, p);
+        }
+
+        prev = p;
     }
 
-    return {rval, points};
+    result.emplace_back(prev, first);
+}
+
+bool Object::is_inside(const Point &p) const
+{
+    ArenaScope scope;
+    ScratchVector<Line> ln;
+    world_lines(ln);
+
+    size_t above = 0;
+    size_t below = 0;
+
+    for_each_intersection(ln.data(), ln.size(), {p, {p.x, 9e10}}, [&](const Point &)
+                          { above++; });
+    for_each_intersection(ln.data(), ln.size(), {p, {p.x, -9e10}}, [&](const Point &)
+                          { below++; });
+
+    return above % 2 && below % 2;
 }
 
 bool Object::collision() const
 {
-    return is_collision_enabled() && std::any_of(s_objects.begin(), s_objects.end(), [&](auto o)
-                                                 { return o != this && o->is_collision_enabled() && collision(*o); });
-}
\ No newline at end of file
+    if (!is_collision_enabled())
+    {
+        return false;
+    }
+
+    // The lines of this object are calculated once when the first candidate is found, the lines of the other
+    // objects only live until the next candidate
+    ArenaScope scope;
+    ScratchVector<Line> mine;
+
+    auto collides = [&](Object *o)
+    {
+        if (o == this || !o->is_collision_enabled() || !overlaps(m_world_rect, o->m_world_rect))
+        {
+            return false;
+        }
+
+        if (mine.empty())
+        {
+            world_lines(mine);
+        }
+
+        ArenaScope candidate;
+        ScratchVector<Line> theirs;
+        o->world_lines(theirs);
+        bool collided = false;
+
+        for (const auto &line : mine)
+        {
+            for_each_intersection(theirs.data(), theirs.size(), line, [&](const Point &p)
+                                  {
+                                      m_world.m_contacts.push_back({this, o, p});
+                                      collided = true;
+                                  });
+        }
+
+        return collided;
+    };
+
+    return m_world.m_static.any_of(m_world_rect, collides) || m_world.m_dynamic.any_of(m_world_rect, collides);
+}
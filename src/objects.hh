@@ -6,6 +6,8 @@
 #include <cmath>
 #include <functional>
 
+#include "arena.hh"
+
 struct Point
 {
     double x = 0;
@@ -98,6 +100,39 @@ inline bool operator==(const Point &lhs, const Point &rhs)
 
 using Line = std::pair<Point, Point>;
 
+// An axis-aligned rectangle stored as the minimum and maximum corners
+using Rect = std::pair<Point, Point>;
+
+inline bool overlaps(const Rect &lhs, const Rect &rhs)
+{
+    return lhs.first.x <= rhs.second.x && rhs.first.x <= lhs.second.x &&
+           lhs.first.y <= rhs.second.y && rhs.first.y <= lhs.second.y;
+}
+
+struct Object;
+class World;
+
+// A reference to an object that can be checked for validity. The generation changes every time the slot is
+// reused, a handle to a destroyed object never resolves to a different object that took its place.
+struct ObjectHandle
+{
+    uint32_t index = UINT32_MAX;
+    uint32_t generation = 0;
+};
+
+inline bool operator==(const ObjectHandle &lhs, const ObjectHandle &rhs)
+{
+    return lhs.index == rhs.index && lhs.generation == rhs.generation;
+}
+
+// A point where an object touched another one
+struct Contact
+{
+    const Object *object;
+    const Object *other;
+    Point point;
+};
+
 // An object that has a position, rotation and a polygon that defines the bounds.
 struct Object
 {
@@ -108,17 +143,37 @@ struct Object
         ACTIVE,    // Object was activated or deactivated
     };
 
-    // Construct an object with bounds consisting of a polygon.
-    Object(std::vector<Point> lines);
+    // Whether the object can move. Static objects are kept in a separate index that is only updated when they
+    // are edited and they are never ticked.
+    enum class Mobility
+    {
+        STATIC,
+        DYNAMIC,
+    };
+
+    // Construct an object with bounds consisting of a polygon. The object is added to the world and removed
+    // from it when it's destroyed.
+    Object(World &world, std::vector<Point> lines, Mobility mobility = Mobility::DYNAMIC);
 
     virtual ~Object();
 
-    // Called when the world advances one tick
-    virtual void tick() = 0;
+    // Called when the world advances. The steps is the number of ticks the object should advance, it is larger
+    // than one when the object is simulated at a reduced rate.
+    virtual void tick(int steps) = 0;
 
     // Called whenever the generic object state changes
     virtual void state_changed(ChangeType state) = 0;
 
+    // Called by the Picker when the mouse enters or leaves the object
+    virtual void hover_changed(bool hover)
+    {
+    }
+
+    World &world() const;
+
+    // The handle of the object in its world
+    ObjectHandle handle() const;
+
     void set_collision_enabled(bool enabled);
 
     bool is_collision_enabled() const;
@@ -127,6 +182,16 @@ struct Object
 
     bool is_active() const;
 
+    Mobility mobility() const;
+
+    // A sleeping object is not ticked until it is woken up. Objects are woken up when their state changes or
+    // when a dynamic object moves near them.
+    bool is_sleeping() const;
+
+    void sleep();
+
+    void wake();
+
     // X and Y position of the object in the world, [0, 0] is the center of the world.
     const Point &position() const;
 
@@ -154,6 +219,9 @@ struct Object
     // The bounding rectangle
     std::pair<Point, Point> bounding_rect() const;
 
+    // The bounding rectangle in world coordinates
+    const Rect &world_rect() const;
+
     // Get the bounding polygon as points, rotated and translated to world coordinates
     std::vector<Point> points() const;
 
@@ -169,7 +237,9 @@ struct Object
     // Get points where this object collides with the given line
     std::pair<bool, std::vector<Point>> get_collisions(const Line &line) const;
 
-    // Check if this object collides with any object
+    // Check if this object collides with any object in its world. Only objects with overlapping world
+    // rectangles are tested. The points where the object touched the first colliding object are added to the
+    // contact list of the world.
     bool collision() const;
 
     // Check if this object collides with another object
@@ -185,26 +255,29 @@ struct Object
     }
 
     // Check if the point is inside this object
-    bool is_inside(const Point &p) const
-    {
-        Point p1{p.x, 9e10};
-        Point p2{p.x, -9e10};
-
-        auto collisions1 = get_collisions({p, p1}).second;
-        auto collisions2 = get_collisions({p, p2}).second;
-
-        return collisions1.size() % 2 && collisions2.size() % 2;
-    }
+    bool is_inside(const Point &p) const;
 
 private:
     std::vector<Line> to_lines(const std::vector<Point> &pts) const;
 
+    // Appends the lines of the polygon in world coordinates, like lines() but into scratch memory
+    void world_lines(ScratchVector<Line> &result) const;
+
+    // Recalculates the world rectangle and moves the object in the spatial index
+    void moved();
+
+    World &m_world;
+    ObjectHandle m_handle;
     Point m_pos{0, 0};
     std::vector<Point> m_bounds;
     double m_dir{0.0};
     Point m_min;
     Point m_max;
     Point m_center;
+    Rect m_world_rect;
+    Mobility m_mobility;
+    uint32_t m_slot;
     bool m_collision{true};
-    bool m_active;
+    bool m_active{true};
+    bool m_sleeping{false};
 };
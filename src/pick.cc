@@ -0,0 +1,123 @@
+#include "pick.hh"
+
+#include <algorithm>
+
+namespace
+{
+    Point center_of(const Object &o)
+    {
+        const auto &r = o.world_rect();
+        return (r.first + r.second) * 0.5;
+    }
+
+    // Even-odd rule
+    bool inside_polygon(const std::vector<Point> &polygon, const Point &p)
+    {
+        bool inside = false;
+
+        for (size_t i = 0, j = polygon.size() - 1; i < polygon.size(); j = i++)
+        {
+            const auto &a = polygon[i];
+            const auto &b = polygon[j];
+
+            if ((a.y > p.y) != (b.y > p.y) && p.x < a.x + (p.y - a.y) * (b.x - a.x) / (b.y - a.y))
+            {
+                inside = !inside;
+            }
+        }
+
+        return inside;
+    }
+}
+
+Picker::Picker(World &world)
+    : m_world(world)
+{
+}
+
+const std::vector<Object *> &Picker::update(const Point &point)
+{
+    m_candidates.clear();
+    m_found.clear();
+    m_world.find({point, point}, Object::Mobility::DYNAMIC, m_candidates);
+
+    for (auto o : m_candidates)
+    {
+        if (o->is_inside(point))
+        {
+            m_found.push_back(o);
+        }
+    }
+
+    for (const auto &h : m_hovered)
+    {
+        Object *o = m_world.get(h);
+
+        if (o && std::find(m_found.begin(), m_found.end(), o) == m_found.end())
+        {
+            o->hover_changed(false);
+        }
+    }
+
+    for (auto o : m_found)
+    {
+        if (std::find(m_hovered.begin(), m_hovered.end(), o->handle()) == m_hovered.end())
+        {
+            o->hover_changed(true);
+        }
+    }
+
+    m_hovered.clear();
+
+    for (auto o : m_found)
+    {
+        m_hovered.push_back(o->handle());
+    }
+
+    return m_found;
+}
+
+void Picker::find_in_rect(const Rect &rect, std::vector<Object *> &result)
+{
+    m_candidates.clear();
+    m_world.find(rect, Object::Mobility::DYNAMIC, m_candidates);
+
+    for (auto o : m_candidates)
+    {
+        auto c = center_of(*o);
+
+        if (c.x >= rect.first.x && c.x <= rect.second.x && c.y >= rect.first.y && c.y <= rect.second.y)
+        {
+            result.push_back(o);
+        }
+    }
+}
+
+void Picker::find_in_polygon(const std::vector<Point> &polygon, std::vector<Object *> &result)
+{
+    if (polygon.size() < 3)
+    {
+        return;
+    }
+
+    Rect bounds{polygon.front(), polygon.front()};
+
+    for (const auto &p : polygon)
+    {
+        bounds.first.x = std::min(bounds.first.x, p.x);
+        bounds.first.y = std::min(bounds.first.y, p.y);
+        bounds.second.x = std::max(bounds.second.x, p.x);
+        bounds.second.y = std::max(bounds.second.y, p.y);
+    }
+
+    m_candidates.clear();
+    m_world.find(bounds, Object::Mobility::DYNAMIC, m_candidates);
+
+    for (auto o : m_candidates)
+    {
+        if (inside_polygon(polygon, center_of(*o)))
+        {
+            result.push_back(o);
+        }
+    }
+}
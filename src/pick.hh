@@ -0,0 +1,30 @@
+#pragma once
+
+#include "world.hh"
+
+#include <vector>
+
+// Finds the objects under the mouse with one spatial query per mouse event. Only the objects that the mouse
+// enters or leaves are notified, the cost doesn't depend on the number of objects in the world.
+class Picker
+{
+public:
+    Picker(World &world);
+
+    // Finds the dynamic objects that contain the point and calls hover_changed() on the ones that the point
+    // entered or left since the last update. The hovered objects are remembered by handle, objects that were
+    // destroyed since then are skipped.
+    const std::vector<Object *> &update(const Point &point);
+
+    // Finds the dynamic objects whose centers are inside the rectangle
+    void find_in_rect(const Rect &rect, std::vector<Object *> &result);
+
+    // Finds the dynamic objects whose centers are inside the polygon
+    void find_in_polygon(const std::vector<Point> &polygon, std::vector<Object *> &result);
+
+private:
+    World &m_world;
+    std::vector<ObjectHandle> m_hovered;
+    std::vector<Object *> m_found;
+    std::vector<Object *> m_candidates;
+};
@@ -0,0 +1,314 @@
+#include "planner.hh"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <limits>
+
+namespace
+{
+    constexpr double SQRT2 = 1.4142135623730951;
+
+    constexpr uint32_t NO_PARENT = UINT32_MAX;
+
+    struct Direction
+    {
+        int dx;
+        int dy;
+        double cost;
+    };
+
+    const Direction DIRECTIONS[] = {
+        {1, 0, 1},
+        {-1, 0, 1},
+        {0, 1, 1},
+        {0, -1, 1},
+        {1, 1, SQRT2},
+        {1, -1, SQRT2},
+        {-1, 1, SQRT2},
+        {-1, -1, SQRT2},
+    };
+
+    // A move into a blocked cell or a diagonal move past the corner of one is not allowed
+    bool can_move(const OccupancyGrid &grid, const GridCell &c, const Direction &d)
+    {
+        return !grid.is_blocked(c.x + d.dx, c.y + d.dy) &&
+               !(d.dx && d.dy && (grid.is_blocked(c.x + d.dx, c.y) || grid.is_blocked(c.x, c.y + d.dy)));
+    }
+}
+
+GridPlanner::GridPlanner(const OccupancyGrid &grid, Algorithm algorithm)
+    : m_grid(grid), m_algorithm(algorithm), m_nodes((size_t)grid.width() * grid.height())
+{
+}
+
+bool GridPlanner::find_path(const GridCell &start, const GridCell &goal, std::vector<GridCell> &path)
+{
+    path.clear();
+    m_stats = Stats{};
+    m_open.clear();
+    m_goal = goal;
+
+    if (++m_search == 0)
+    {
+        // The counter wrapped around, the old stamps could match the new ones
+        for (auto &n : m_nodes)
+        {
+            n.search = 0;
+        }
+
+        m_search = 1;
+    }
+
+    bool found = false;
+
+    if (!m_grid.is_blocked(start.x, start.y) && !m_grid.is_blocked(goal.x, goal.y))
+    {
+        uint32_t start_index = m_grid.index(start.x, start.y);
+        uint32_t goal_index = m_grid.index(goal.x, goal.y);
+        node(start_index).parent = NO_PARENT;
+        push(0, start_index);
+
+        while (!m_open.empty())
+        {
+            std::pop_heap(m_open.begin(), m_open.end());
+            Open top = m_open.back();
+            m_open.pop_back();
+            m_stats.heap_pops++;
+
+            Node &current = m_nodes[top.index];
+
+            // Nodes are pushed again when a shorter path is found, the old entries are skipped here
+            if (current.closed || top.g > current.g)
+            {
+                continue;
+            }
+
+            if (m_algorithm == Algorithm::LAZY_THETA_STAR)
+            {
+                set_vertex(top.index);
+            }
+
+            current.closed = true;
+            m_stats.expanded++;
+
+            if (top.index == goal_index)
+            {
+                found = true;
+                break;
+            }
+
+            GridCell c = m_grid.cell(top.index);
+
+            for (const auto &d : DIRECTIONS)
+            {
+                if (!can_move(m_grid, c, d))
+                {
+                    continue;
+                }
+
+                uint32_t index = m_grid.index(c.x + d.dx, c.y + d.dy);
+                Node &next = node(index);
+
+                if (next.closed)
+                {
+                    continue;
+                }
+
+                // Theta* skips this cell if the neighbor can be reached straight from its parent. Lazy Theta*
+                // takes the shortcut without looking and fixes it in set_vertex() if it was wrong.
+                uint32_t parent = top.index;
+                double g = current.g + d.cost;
+                uint32_t grandparent = current.parent;
+
+                if (grandparent != NO_PARENT &&
+                    (m_algorithm == Algorithm::LAZY_THETA_STAR ||
+                     (m_algorithm == Algorithm::THETA_STAR && line_of_sight(grandparent, index))))
+                {
+                    parent = grandparent;
+                    g = m_nodes[grandparent].g + distance(grandparent, index);
+                }
+
+                if (g < next.g)
+                {
+                    next.parent = parent;
+                    push(g, index);
+                }
+            }
+        }
+
+        if (found)
+        {
+            for (uint32_t i = goal_index; i != NO_PARENT; i = m_nodes[i].parent)
+            {
+                path.push_back(m_grid.cell(i));
+            }
+
+            std::reverse(path.begin(), path.end());
+        }
+    }
+
+    m_stats.memory = m_nodes.capacity() * sizeof(Node) + m_open.capacity() * sizeof(Open);
+    return found;
+}
+
+const GridPlanner::Stats &GridPlanner::stats() const
+{
+    return m_stats;
+}
+
+void GridPlanner::expanded(std::vector<GridCell> &cells) const
+{
+    cells.clear();
+
+    for (uint32_t i = 0; i < m_nodes.size(); i++)
+    {
+        if (m_nodes[i].search == m_search && m_nodes[i].closed)
+        {
+            cells.push_back(m_grid.cell(i));
+        }
+    }
+}
+
+GridPlanner::Algorithm GridPlanner::algorithm() const
+{
+    return m_algorithm;
+}
+
+// static
+GridPlanner::Algorithm GridPlanner::parse_algorithm(const std::string &name)
+{
+    if (name == "astar")
+    {
+        return Algorithm::A_STAR;
+    }
+    else if (name == "theta")
+    {
+        return Algorithm::THETA_STAR;
+    }
+    else if (name == "lazy-theta")
+    {
+        return Algorithm::LAZY_THETA_STAR;
+    }
+
+    throw Error("Unknown planner: " + name);
+}
+
+// static
+const char *GridPlanner::algorithm_name(Algorithm algorithm)
+{
+    switch (algorithm)
+    {
+    case Algorithm::A_STAR:
+        return "astar";
+
+    case Algorithm::THETA_STAR:
+        return "theta";
+
+    case Algorithm::LAZY_THETA_STAR:
+        return "lazy-theta";
+    }
+
+    return "";
+}
+
+// static
+double GridPlanner::length(const std::vector<GridCell> &path)
+{
+    double len = 0;
+
+    for (size_t i = 1; i < path.size(); i++)
+    {
+        double dx = path[i].x - path[i - 1].x;
+        double dy = path[i].y - path[i - 1].y;
+        len += sqrt(dx * dx + dy * dy);
+    }
+
+    return len;
+}
+
+double GridPlanner::heuristic(uint32_t index) const
+{
+    GridCell c = m_grid.cell(index);
+    double dx = abs(c.x - m_goal.x);
+    double dy = abs(c.y - m_goal.y);
+
+    if (m_algorithm == Algorithm::A_STAR)
+    {
+        // Octile distance, the exact cost on an empty grid
+        return std::max(dx, dy) + (SQRT2 - 1) * std::min(dx, dy);
+    }
+
+    // Any-angle paths can be shorter than the octile distance, only the straight line never overestimates
+    return sqrt(dx * dx + dy * dy);
+}
+
+double GridPlanner::distance(uint32_t from, uint32_t to) const
+{
+    GridCell a = m_grid.cell(from);
+    GridCell b = m_grid.cell(to);
+    double dx = a.x - b.x;
+    double dy = a.y - b.y;
+    return sqrt(dx * dx + dy * dy);
+}
+
+bool GridPlanner::line_of_sight(uint32_t from, uint32_t to)
+{
+    m_stats.line_of_sight++;
+    return m_grid.line_of_sight(m_grid.cell(from), m_grid.cell(to));
+}
+
+void GridPlanner::set_vertex(uint32_t index)
+{
+    Node &n = m_nodes[index];
+
+    if (n.parent == NO_PARENT || line_of_sight(n.parent, index))
+    {
+        return;
+    }
+
+    // The node was generated by expanding one of its neighbors, the closed neighbor with the shortest path
+    // through it becomes the parent
+    GridCell c = m_grid.cell(index);
+    n.g = std::numeric_limits<double>::max();
+
+    for (const auto &d : DIRECTIONS)
+    {
+        if (!can_move(m_grid, c, d))
+        {
+            continue;
+        }
+
+        uint32_t neighbor = m_grid.index(c.x + d.dx, c.y + d.dy);
+        const Node &other = node(neighbor);
+
+        if (other.closed && other.g + d.cost < n.g)
+        {
+            n.g = other.g + d.cost;
+            n.parent = neighbor;
+        }
+    }
+}
+
+void GridPlanner::push(double g, uint32_t index)
+{
+    m_nodes[index].g = g;
+    m_open.push_back({g + heuristic(index), g, index});
+    std::push_heap(m_open.begin(), m_open.end());
+    m_stats.heap_pushes++;
+}
+
+GridPlanner::Node &GridPlanner::node(uint32_t index)
+{
+    Node &n = m_nodes[index];
+
+    if (n.search != m_search)
+    {
+        n.g = std::numeric_limits<double>::max();
+        n.parent = NO_PARENT;
+        n.search = m_search;
+        n.closed = false;
+    }
+
+    return n;
+}
@@ -0,0 +1,108 @@
+#pragma once
+
+#include "grid.hh"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Finds shortest paths on an occupancy grid. Moves go to the eight neighboring cells, diagonal moves cost
+// sqrt(2) and are not allowed to cut the corner of a blocked cell. These are the same rules that the MovingAI
+// benchmark uses for its optimal path lengths.
+//
+// A* finds the shortest path made out of these moves, which zig-zags whenever the direction to the goal isn't
+// one of the eight. Theta* and Lazy Theta* search the same graph but connect a cell straight to the parent of
+// the cell it was reached from whenever the two are in line of sight, the paths come out as a few straight
+// segments at any angle. Theta* checks the line of sight for every neighbor it generates, Lazy Theta* assumes
+// it and only checks it once the neighbor is expanded, which skips the checks for the cells that never are.
+//
+// The per-cell search state is allocated once and reused between queries, a query only touches the cells that
+// it visits.
+class GridPlanner
+{
+public:
+    enum class Algorithm
+    {
+        A_STAR,
+        THETA_STAR,
+        LAZY_THETA_STAR,
+    };
+
+    // The work done by the last query
+    struct Stats
+    {
+        uint64_t expanded = 0;  // Nodes removed from the open list and expanded
+        uint64_t heap_pushes = 0;
+        uint64_t heap_pops = 0;
+        uint64_t line_of_sight = 0; // Line of sight checks done by Theta* and Lazy Theta*
+        size_t memory = 0;      // Bytes used by the search state, including the peak size of the open list
+    };
+
+    GridPlanner(const OccupancyGrid &grid, Algorithm algorithm = Algorithm::A_STAR);
+
+    // Finds a path from start to goal. The path is the list of cells from start to goal, both included. With A*
+    // every cell along the path is listed, with Theta* and Lazy Theta* only the cells where the path turns and
+    // each cell is in line of sight of the next one. Returns false if the goal can't be reached.
+    bool find_path(const GridCell &start, const GridCell &goal, std::vector<GridCell> &path);
+
+    const Stats &stats() const;
+
+    // The cells expanded by the last query. Goes over the whole grid, meant for debug views.
+    void expanded(std::vector<GridCell> &cells) const;
+
+    Algorithm algorithm() const;
+
+    // Parses the algorithm name: astar, theta or lazy-theta
+    static Algorithm parse_algorithm(const std::string &name);
+
+    static const char *algorithm_name(Algorithm algorithm);
+
+    // The length of the path in cells
+    static double length(const std::vector<GridCell> &path);
+
+private:
+    struct Node
+    {
+        double g;
+        uint32_t parent;
+        uint32_t search; // The query that last touched this node, the rest of the node is stale if it's old
+        bool closed;
+    };
+
+    struct Open
+    {
+        double f;
+        double g;
+        uint32_t index;
+
+        // The open list is a max-heap, the node with the lowest f is the largest one. Ties are broken towards
+        // the deeper node, it's closer to the goal.
+        bool operator<(const Open &rhs) const
+        {
+            return f > rhs.f || (f == rhs.f && g < rhs.g);
+        }
+    };
+
+    double heuristic(uint32_t index) const;
+
+    // The straight line distance between the cells
+    double distance(uint32_t from, uint32_t to) const;
+
+    bool line_of_sight(uint32_t from, uint32_t to);
+
+    // Lazy Theta* assumed that the node can see the parent it was given, if it can't, the best closed neighbor
+    // becomes its parent instead
+    void set_vertex(uint32_t index);
+
+    void push(double g, uint32_t index);
+
+    Node &node(uint32_t index);
+
+    const OccupancyGrid &m_grid;
+    Algorithm m_algorithm;
+    std::vector<Node> m_nodes;
+    std::vector<Open> m_open;
+    uint32_t m_search = 0;
+    GridCell m_goal;
+    Stats m_stats;
+};
@@ -0,0 +1,99 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <vector>
+
+// Fixed-size blocks for objects of type T, carved out of chunks of N blocks. Objects that are created one after
+// another end up next to each other in memory. Freed blocks go to a free list and are reused by the next
+// allocation, the chunks are only released when the program exits.
+template <class T, size_t N = 256>
+class ObjectPool
+{
+public:
+    static void *allocate()
+    {
+        std::lock_guard guard(s_lock);
+
+        if (!s_free)
+        {
+            auto chunk = std::make_unique<Block[]>(N);
+
+            // Linked in order so that the blocks are handed out from the start of the chunk
+            for (size_t i = 0; i < N - 1; i++)
+            {
+                chunk[i].next = &chunk[i + 1];
+            }
+
+            chunk[N - 1].next = nullptr;
+            s_free = &chunk[0];
+            s_chunks.push_back(std::move(chunk));
+        }
+
+        Block *block = s_free;
+        s_free = block->next;
+        ++s_size;
+        return block->storage;
+    }
+
+    static void deallocate(void *ptr)
+    {
+        std::lock_guard guard(s_lock);
+        Block *block = reinterpret_cast<Block *>(ptr);
+        block->next = s_free;
+        s_free = block;
+        --s_size;
+    }
+
+    // The number of allocated objects
+    static size_t size()
+    {
+        std::lock_guard guard(s_lock);
+        return s_size;
+    }
+
+    // The number of objects that fit into the chunks
+    static size_t capacity()
+    {
+        std::lock_guard guard(s_lock);
+        return s_chunks.size() * N;
+    }
+
+private:
+    union Block
+    {
+        Block *next;
+        alignas(T) unsigned char storage[sizeof(T)];
+    };
+
+    static inline std::mutex s_lock;
+    static inline std::vector<std::unique_ptr<Block[]>> s_chunks;
+    static inline Block *s_free = nullptr;
+    static inline size_t s_size = 0;
+};
+
+// Inheriting from this makes new and delete use an ObjectPool. Classes derived from T that are larger than it
+// fall back to the global allocator.
+template <class T>
+class Pooled
+{
+public:
+    static void *operator new(size_t size)
+    {
+        return size == sizeof(T) ? ObjectPool<T>::allocate() : ::operator new(size);
+    }
+
+    static void operator delete(void *ptr, size_t size)
+    {
+        if (size == sizeof(T))
+        {
+            ObjectPool<T>::deallocate(ptr);
+        }
+        else
+        {
+            ::operator delete(ptr);
+        }
+    }
+};
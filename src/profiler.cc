@@ -0,0 +1,302 @@
+#include "profiler.hh"
+#include "common.hh"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace
+{
+    // Samples written by one thread and read by end_frame(). The writer publishes a sample by advancing the
+    // head and the reader frees the slots by advancing the tail. If the reader falls behind by more than the
+    // capacity, new samples are dropped until it catches up so a slot is never written while it's being read.
+    struct Ring
+    {
+        static constexpr size_t CAPACITY = 1 << 16;
+
+        Profiler::Sample samples[CAPACITY];
+        std::atomic<uint64_t> head{0};
+        std::atomic<uint64_t> tail{0};
+        std::atomic<uint64_t> dropped{0};
+        uint32_t thread;
+    };
+
+    struct Scope
+    {
+        const char *name;
+        double totals[Profiler::HISTORY]{}; // Milliseconds per frame
+        double current{0};
+    };
+
+    struct ProfilerData
+    {
+        // Only locked when a thread records its first sample and when the samples are collected
+        std::mutex lock;
+        std::vector<std::unique_ptr<Ring>> rings;
+
+        // Owned by the thread that calls end_frame()
+        std::vector<Scope> scopes;
+        uint64_t frames{0};
+
+        // Samples that didn't fit into the rings, in total and in the recent frames
+        uint64_t dropped{0};
+        uint64_t dropped_history[Profiler::HISTORY]{};
+
+        // The raw samples of the recent frames for the trace, used as a ring buffer
+        std::vector<Profiler::Sample> trace;
+        size_t trace_pos{0};
+
+        // Scratch space for the percentiles
+        std::vector<double> values;
+    };
+
+    constexpr size_t TRACE_SAMPLES = 1 << 16;
+
+    ProfilerData s_profiler;
+
+    // The ring of a registered thread, it's freed when the thread exits
+    struct ThreadRing
+    {
+        Ring *ring = nullptr;
+
+        ~ThreadRing()
+        {
+            if (ring)
+            {
+                std::lock_guard guard(s_profiler.lock);
+                auto &rings = s_profiler.rings;
+                rings.erase(std::find_if(rings.begin(), rings.end(), [&](const auto &r)
+                                         { return r.get() == ring; }));
+            }
+        }
+    };
+
+    thread_local ThreadRing t_ring;
+
+    uint32_t s_next_thread = 1;
+
+    Scope &scope_of(const char *name)
+    {
+        auto &scopes = s_profiler.scopes;
+        auto it = std::find_if(scopes.begin(), scopes.end(), [&](const Scope &s)
+                               { return s.name == name; });
+
+        if (it == scopes.end())
+        {
+            scopes.push_back(Scope{name});
+            it = scopes.end() - 1;
+        }
+
+        return *it;
+    }
+}
+
+// static
+uint64_t Profiler::now()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+}
+
+// static
+void Profiler::register_thread()
+{
+    if (!t_ring.ring)
+    {
+        std::lock_guard guard(s_profiler.lock);
+        s_profiler.rings.push_back(std::make_unique<Ring>());
+        t_ring.ring = s_profiler.rings.back().get();
+        t_ring.ring->thread = s_next_thread++;
+    }
+}
+
+// static
+void Profiler::record(const char *name, uint64_t start, uint64_t end)
+{
+    Ring *ring = t_ring.ring;
+
+    if (!ring)
+    {
+        return;
+    }
+
+    uint64_t head = ring->head.load(std::memory_order_relaxed);
+
+    if (head - ring->tail.load(std::memory_order_acquire) >= Ring::CAPACITY)
+    {
+        ring->dropped.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+
+    ring->samples[head % Ring::CAPACITY] = {name, start, end, ring->thread};
+    ring->head.store(head + 1, std::memory_order_release);
+}
+
+// static
+void Profiler::end_frame()
+{
+    auto &p = s_profiler;
+
+    if (p.trace.empty())
+    {
+        p.trace.resize(TRACE_SAMPLES);
+    }
+
+    auto collect = [&](const Sample &sample)
+    {
+        scope_of(sample.name).current += (sample.end - sample.start) / 1e6;
+        p.trace[p.trace_pos++ % TRACE_SAMPLES] = sample;
+    };
+
+    uint64_t dropped = 0;
+
+    {
+        std::lock_guard guard(p.lock);
+
+        for (auto &ring : p.rings)
+        {
+            dropped += ring->dropped.exchange(0, std::memory_order_relaxed);
+
+            uint64_t head = ring->head.load(std::memory_order_acquire);
+            uint64_t tail = ring->tail.load(std::memory_order_relaxed);
+
+            for (; tail < head; tail++)
+            {
+                collect(ring->samples[tail % Ring::CAPACITY]);
+            }
+
+            ring->tail.store(tail, std::memory_order_release);
+        }
+    }
+
+    for (auto &scope : p.scopes)
+    {
+        scope.totals[p.frames % HISTORY] = scope.current;
+        scope.current = 0;
+    }
+
+    p.dropped += dropped;
+    p.dropped_history[p.frames % HISTORY] = dropped;
+    ++p.frames;
+}
+
+// static
+void Profiler::summary(std::string &out)
+{
+    auto &p = s_profiler;
+    size_t frames = std::min<uint64_t>(p.frames, HISTORY);
+    auto &values = p.values;
+    char line[128];
+
+    out.clear();
+
+    if (frames == 0)
+    {
+        return;
+    }
+
+    snprintf(line, sizeof(line), "%-10s %7s %7s %7s\n", "ms", "p50", "p90", "p99");
+    out += line;
+
+    for (const auto &scope : p.scopes)
+    {
+        values.assign(scope.totals, scope.totals + frames);
+        std::sort(values.begin(), values.end());
+        double p50 = percentile(values, 0.5);
+        double p90 = percentile(values, 0.9);
+        double p99 = percentile(values, 0.99);
+        snprintf(line, sizeof(line), "%-10s %7.3f %7.3f %7.3f\n", scope.name, p50, p90, p99);
+        out += line;
+    }
+
+    // The totals above are missing the samples that were dropped
+    uint64_t dropped = 0;
+
+    for (size_t i = 0; i < frames; i++)
+    {
+        dropped += p.dropped_history[i];
+    }
+
+    if (dropped)
+    {
+        snprintf(line, sizeof(line), "dropped %llu samples\n", (unsigned long long)dropped);
+        out += line;
+    }
+}
+
+// static
+uint64_t Profiler::dropped()
+{
+    return s_profiler.dropped;
+}
+
+// static
+void Profiler::write_csv(const std::string &filename)
+{
+    auto &p = s_profiler;
+    std::ofstream file(filename);
+
+    if (!file)
+    {
+        throw Error("Could not open " + filename + " for writing");
+    }
+
+    file << "frame";
+
+    for (const auto &scope : p.scopes)
+    {
+        file << ',' << scope.name;
+    }
+
+    file << '\n';
+
+    uint64_t first = p.frames - std::min<uint64_t>(p.frames, HISTORY);
+
+    for (uint64_t frame = first; frame < p.frames; frame++)
+    {
+        file << frame;
+
+        for (const auto &scope : p.scopes)
+        {
+            file << ',' << scope.totals[frame % HISTORY];
+        }
+
+        file << '\n';
+    }
+}
+
+// static
+void Profiler::write_trace(const std::string &filename)
+{
+    auto &p = s_profiler;
+    std::ofstream file(filename);
+
+    if (!file)
+    {
+        throw Error("Could not open " + filename + " for writing");
+    }
+
+    size_t count = std::min(p.trace_pos, TRACE_SAMPLES);
+    bool first = true;
+
+    // The timestamps are in microseconds
+    file.setf(std::ios::fixed);
+    file.precision(3);
+
+    file << "{\"traceEvents\":[\n";
+
+    for (size_t i = p.trace_pos - count; i < p.trace_pos; i++)
+    {
+        const auto &s = p.trace[i % TRACE_SAMPLES];
+        file << (first ? "" : ",\n") << "{\"name\":\"" << s.name << "\",\"ph\":\"X\",\"pid\":1,\"tid\":" << s.thread
+             << ",\"ts\":" << s.start / 1000.0 << ",\"dur\":" << (s.end - s.start) / 1000.0 << '}';
+        first = false;
+    }
+
+    file << "\n]}\n";
+}
@@ -0,0 +1,78 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+
+// A frame profiler. Scoped timers write into a ring buffer that belongs to the thread, the samples are
+// collected into per-frame totals by Profiler::end_frame() on the main thread. Recording doesn't take any
+// locks, a ring buffer only has one writer. Only the threads that have called register_thread() are profiled,
+// the timers on other threads don't record anything.
+//
+// The timers are only compiled in when NAVIGATOR_PROFILER is defined, otherwise PROFILE_SCOPE expands to
+// nothing.
+class Profiler
+{
+public:
+    struct Sample
+    {
+        const char *name; // Must be a string literal, scopes are identified by the pointer
+        uint64_t start;   // Nanoseconds
+        uint64_t end;
+        uint32_t thread;
+    };
+
+    // The number of frames the percentiles and the CSV are calculated from
+    static constexpr size_t HISTORY = 256;
+
+    static uint64_t now();
+
+    // Starts profiling the calling thread. The samples of the thread are collected until it exits.
+    static void register_thread();
+
+    static void record(const char *name, uint64_t start, uint64_t end);
+
+    // Ends the current frame and collects the samples of all threads
+    static void end_frame();
+
+    // The p50, p90 and p99 of the per-frame time of each scope, one line per scope, followed by the number of
+    // samples dropped in those frames if there were any
+    static void summary(std::string &out);
+
+    // The number of samples dropped since the start because the ring of the thread was full. Only updated by
+    // end_frame().
+    static uint64_t dropped();
+
+    // The per-frame totals of each scope in milliseconds, one row per frame
+    static void write_csv(const std::string &filename);
+
+    // The samples of the recent frames in the Chrome trace event format, viewable in chrome://tracing
+    static void write_trace(const std::string &filename);
+};
+
+class ProfileScope
+{
+public:
+    ProfileScope(const char *name)
+        : m_name(name), m_start(Profiler::now())
+    {
+    }
+
+    ~ProfileScope()
+    {
+        Profiler::record(m_name, m_start, Profiler::now());
+    }
+
+private:
+    const char *m_name;
+    uint64_t m_start;
+};
+
+#define PROFILE_CONCAT_(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_(a, b)
+
+#ifdef NAVIGATOR_PROFILER
+#define PROFILE_SCOPE(name) ProfileScope PROFILE_CONCAT(profile_scope_, __LINE__)(name)
+#else
+#define PROFILE_SCOPE(name)
+#endif
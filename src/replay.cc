@@ -0,0 +1,292 @@
+#include "replay.hh"
+
+#include <algorithm>
+#include <iterator>
+
+namespace
+{
+    const char MAGIC[4] = {'N', 'A', 'V', 'R'};
+    const uint64_t VERSION = 1;
+
+    // The event types as they are stored in the log
+    enum Record : uint8_t
+    {
+        END,
+        QUIT,
+        KEYDOWN,
+        KEYUP,
+        MOUSEMOTION,
+        MOUSEBUTTONDOWN,
+        MOUSEBUTTONUP,
+        MOUSEWHEEL,
+    };
+
+    class Reader
+    {
+    public:
+        Reader(std::vector<uint8_t> data)
+            : m_data(std::move(data))
+        {
+        }
+
+        bool at_end() const
+        {
+            return m_offset >= m_data.size();
+        }
+
+        uint8_t byte()
+        {
+            if (at_end())
+            {
+                throw Error("Truncated event log");
+            }
+
+            return m_data[m_offset++];
+        }
+
+        uint64_t read()
+        {
+            uint64_t value = 0;
+            int shift = 0;
+            uint8_t b;
+
+            do
+            {
+                b = byte();
+                value |= (uint64_t)(b & 0x7f) << shift;
+                shift += 7;
+            } while (b & 0x80);
+
+            return value;
+        }
+
+        int64_t read_signed()
+        {
+            uint64_t value = read();
+            return (int64_t)(value >> 1) ^ -(int64_t)(value & 1);
+        }
+
+    private:
+        std::vector<uint8_t> m_data;
+        size_t m_offset = 0;
+    };
+}
+
+//
+// EventRecorder
+//
+
+EventRecorder::EventRecorder(const std::string &filename)
+    : m_file(filename, std::ios::binary | std::ios::trunc)
+{
+    if (!m_file)
+    {
+        throw Error("Could not open " + filename + " for writing");
+    }
+
+    m_file.write(MAGIC, sizeof(MAGIC));
+    write(VERSION);
+}
+
+EventRecorder::~EventRecorder()
+{
+    write_header(m_last_tick, END);
+}
+
+void EventRecorder::set_tick(uint64_t tick)
+{
+    m_last_tick = std::max(m_last_tick, tick);
+}
+
+void EventRecorder::record(uint64_t tick, const SDL_Event &event, uint16_t modifiers)
+{
+    switch (event.type)
+    {
+    case SDL_QUIT:
+        write_header(tick, QUIT);
+        write(modifiers);
+        break;
+
+    case SDL_KEYDOWN:
+    case SDL_KEYUP:
+        write_header(tick, event.type == SDL_KEYDOWN ? KEYDOWN : KEYUP);
+        write(modifiers);
+        write_signed(event.key.keysym.sym);
+        write(event.key.keysym.mod);
+        write(event.key.repeat);
+        break;
+
+    case SDL_MOUSEMOTION:
+        write_header(tick, MOUSEMOTION);
+        write(modifiers);
+        write_signed(event.motion.x);
+        write_signed(event.motion.y);
+        write_signed(event.motion.xrel);
+        write_signed(event.motion.yrel);
+        write(event.motion.state);
+        break;
+
+    case SDL_MOUSEBUTTONDOWN:
+    case SDL_MOUSEBUTTONUP:
+        write_header(tick, event.type == SDL_MOUSEBUTTONDOWN ? MOUSEBUTTONDOWN : MOUSEBUTTONUP);
+        write(modifiers);
+        write(event.button.button);
+        write(event.button.clicks);
+        write_signed(event.button.x);
+        write_signed(event.button.y);
+        break;
+
+    case SDL_MOUSEWHEEL:
+        write_header(tick, MOUSEWHEEL);
+        write(modifiers);
+        write_signed(event.wheel.x);
+        write_signed(event.wheel.y);
+        write(event.wheel.direction);
+        break;
+
+    default:
+        break;
+    }
+}
+
+void EventRecorder::write_header(uint64_t tick, uint8_t type)
+{
+    set_tick(tick);
+    write(tick - m_prev_tick);
+    m_file.put(type);
+    m_prev_tick = tick;
+}
+
+void EventRecorder::write(uint64_t value)
+{
+    do
+    {
+        uint8_t b = value & 0x7f;
+        value >>= 7;
+        m_file.put(value ? b | 0x80 : b);
+    } while (value);
+}
+
+void EventRecorder::write_signed(int64_t value)
+{
+    // Zig-zag encoding keeps small negative numbers small
+    write(((uint64_t)value << 1) ^ (uint64_t)(value >> 63));
+}
+
+//
+// EventPlayer
+//
+
+EventPlayer::EventPlayer(const std::string &filename)
+{
+    std::ifstream file(filename, std::ios::binary);
+
+    if (!file)
+    {
+        throw Error("Could not open " + filename);
+    }
+
+    std::vector<uint8_t> data{std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>()};
+    Reader reader(std::move(data));
+
+    for (char c : MAGIC)
+    {
+        if (reader.at_end() || reader.byte() != (uint8_t)c)
+        {
+            throw Error(filename + " is not an event log");
+        }
+    }
+
+    if (auto version = reader.read(); version != VERSION)
+    {
+        throw Error("Unsupported event log version: " + std::to_string(version));
+    }
+
+    uint64_t tick = 0;
+
+    while (!reader.at_end())
+    {
+        tick += reader.read();
+        uint8_t type = reader.byte();
+
+        if (type == END)
+        {
+            m_end_tick = tick;
+            break;
+        }
+
+        Event ev{};
+        ev.tick = tick;
+        ev.modifiers = reader.read();
+        auto &e = ev.event;
+
+        switch (type)
+        {
+        case QUIT:
+            e.type = SDL_QUIT;
+            break;
+
+        case KEYDOWN:
+        case KEYUP:
+            e.type = type == KEYDOWN ? SDL_KEYDOWN : SDL_KEYUP;
+            e.key.state = type == KEYDOWN ? SDL_PRESSED : SDL_RELEASED;
+            e.key.keysym.sym = reader.read_signed();
+            e.key.keysym.mod = reader.read();
+            e.key.repeat = reader.read();
+            break;
+
+        case MOUSEMOTION:
+            e.type = SDL_MOUSEMOTION;
+            e.motion.x = reader.read_signed();
+            e.motion.y = reader.read_signed();
+            e.motion.xrel = reader.read_signed();
+            e.motion.yrel = reader.read_signed();
+            e.motion.state = reader.read();
+            break;
+
+        case MOUSEBUTTONDOWN:
+        case MOUSEBUTTONUP:
+            e.type = type == MOUSEBUTTONDOWN ? SDL_MOUSEBUTTONDOWN : SDL_MOUSEBUTTONUP;
+            e.button.state = type == MOUSEBUTTONDOWN ? SDL_PRESSED : SDL_RELEASED;
+            e.button.button = reader.read();
+            e.button.clicks = reader.read();
+            e.button.x = reader.read_signed();
+            e.button.y = reader.read_signed();
+            break;
+
+        case MOUSEWHEEL:
+            e.type = SDL_MOUSEWHEEL;
+            e.wheel.x = reader.read_signed();
+            e.wheel.y = reader.read_signed();
+            e.wheel.direction = reader.read();
+            break;
+
+        default:
+            throw Error("Unknown record type in event log: " + std::to_string(type));
+        }
+
+        m_events.push_back(ev);
+        m_end_tick = tick;
+    }
+}
+
+bool EventPlayer::next(uint64_t tick, Event &event)
+{
+    if (m_pos < m_events.size() && m_events[m_pos].tick <= tick)
+    {
+        event = m_events[m_pos++];
+        return true;
+    }
+
+    return false;
+}
+
+bool EventPlayer::done(uint64_t tick) const
+{
+    return m_pos == m_events.size() && tick > m_end_tick;
+}
+
+uint64_t EventPlayer::ticks() const
+{
+    return m_end_tick + 1;
+}
@@ -0,0 +1,68 @@
+#pragma once
+
+#include "common.hh"
+
+#include <fstream>
+#include <vector>
+
+// Records the input events and the tick they were handled on into a compact binary log. Only the event types
+// that the program reacts to are recorded, everything else is dropped.
+//
+// The log starts with a header followed by one record per event. A record consists of the number of ticks
+// since the previous record and the event type followed by the fields of the event, all of them encoded as
+// variable length integers. The log ends with a record that marks the last tick of the recording.
+class EventRecorder
+{
+public:
+    EventRecorder(const EventRecorder &) = delete;
+    EventRecorder &operator=(const EventRecorder &) = delete;
+
+    EventRecorder(const std::string &filename);
+
+    // Writes the end marker and closes the file
+    ~EventRecorder();
+
+    // Record an event handled on the given tick along with the modifier state at the time
+    void record(uint64_t tick, const SDL_Event &event, uint16_t modifiers);
+
+    // Advance the end of the recording to the given tick
+    void set_tick(uint64_t tick);
+
+private:
+    void write_header(uint64_t tick, uint8_t type);
+    void write(uint64_t value);
+    void write_signed(int64_t value);
+
+    std::ofstream m_file;
+    uint64_t m_prev_tick = 0;
+    uint64_t m_last_tick = 0;
+};
+
+// Plays back a log created by EventRecorder
+class EventPlayer
+{
+public:
+    struct Event
+    {
+        uint64_t tick;
+        uint16_t modifiers;
+        SDL_Event event;
+    };
+
+    EventPlayer(const std::string &filename);
+
+    // Get the next event that was handled on the given tick. Returns false if there are no more events on
+    // this tick.
+    bool next(uint64_t tick, Event &event);
+
+    // True when the given tick is past the end of the recording
+    bool done(uint64_t tick) const;
+
+    // The number of ticks in the recording
+    uint64_t ticks() const;
+
+private:
+    std::vector<Event> m_events;
+    size_t m_pos = 0;
+    uint64_t m_end_tick = 0;
+};
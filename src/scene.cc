@@ -0,0 +1,268 @@
+#include "scene.hh"
+
+#include <cerrno>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace
+{
+    const char MAGIC[4] = {'N', 'A', 'V', 'S'};
+
+    uint64_t align(uint64_t offset)
+    {
+        return (offset + 7) & ~(uint64_t)7;
+    }
+}
+
+//
+// SceneData
+//
+
+SceneData::SceneData()
+    : m_wall_offsets{0}
+{
+}
+
+void SceneData::add_wall(const std::vector<Point> &outline)
+{
+    m_vertices.insert(m_vertices.end(), outline.begin(), outline.end());
+    m_wall_offsets.push_back(m_vertices.size());
+}
+
+void SceneData::add_agent(Point position, double rotation, bool active, bool collision)
+{
+    AgentRecord agent{};
+    agent.position = position;
+    agent.rotation = rotation;
+    agent.flags = (active ? AgentRecord::ACTIVE : 0) | (collision ? AgentRecord::COLLISION : 0);
+    m_agents.push_back(agent);
+}
+
+SceneView SceneData::view() const
+{
+    SceneView view;
+    view.wall_offsets = m_wall_offsets.data();
+    view.wall_count = m_wall_offsets.size() - 1;
+    view.vertices = m_vertices.data();
+    view.vertex_count = m_vertices.size();
+    view.agents = m_agents.data();
+    view.agent_count = m_agents.size();
+    return view;
+}
+
+//
+// SceneFile
+//
+
+SceneFile::SceneFile(const std::string &filename)
+{
+#ifdef _WIN32
+    m_file = CreateFileA(filename.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+
+    if (m_file == INVALID_HANDLE_VALUE)
+    {
+        m_file = nullptr;
+        throw Error("Could not open " + filename);
+    }
+
+    LARGE_INTEGER size;
+    GetFileSizeEx(m_file, &size);
+    m_size = size.QuadPart;
+    m_mapping = CreateFileMappingA(m_file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    m_data = m_mapping ? MapViewOfFile(m_mapping, FILE_MAP_READ, 0, 0, 0) : nullptr;
+#else
+    int fd = open(filename.c_str(), O_RDONLY);
+
+    if (fd == -1)
+    {
+        throw Error("Could not open " + filename + ": " + strerror(errno));
+    }
+
+    struct stat st;
+    fstat(fd, &st);
+    m_size = st.st_size;
+    m_data = m_size ? mmap(nullptr, m_size, PROT_READ, MAP_PRIVATE, fd, 0) : nullptr;
+    close(fd);
+
+    if (m_data == MAP_FAILED)
+    {
+        m_data = nullptr;
+    }
+#endif
+
+    // The destructor is not called if the constructor throws
+    auto fail = [&](const std::string &message)
+    {
+        unmap();
+        throw Error(filename + ": " + message);
+    };
+
+    if (!m_data || m_size < sizeof(SceneHeader))
+    {
+        fail("Could not map file or the file is too small");
+    }
+
+    const char *base = static_cast<const char *>(m_data);
+    const auto *header = reinterpret_cast<const SceneHeader *>(base);
+
+    if (memcmp(header->magic, MAGIC, sizeof(MAGIC)) != 0)
+    {
+        fail("Not a scene file");
+    }
+    else if (header->version != SceneHeader::VERSION)
+    {
+        fail("Unsupported scene version " + std::to_string(header->version));
+    }
+
+    auto section = [&](uint64_t offset, uint64_t count, size_t size)
+    {
+        if (offset % 8 || offset > m_size || count * size > m_size - offset)
+        {
+            fail("Invalid section offset");
+        }
+
+        return base + offset;
+    };
+
+    m_view.wall_count = header->wall_count;
+    m_view.vertex_count = header->vertex_count;
+    m_view.agent_count = header->agent_count;
+    m_view.wall_offsets = reinterpret_cast<const uint32_t *>(
+        section(header->wall_offsets, header->wall_count + 1ull, sizeof(uint32_t)));
+    m_view.vertices = reinterpret_cast<const Point *>(
+        section(header->vertices, header->vertex_count, sizeof(Point)));
+    m_view.agents = reinterpret_cast<const AgentRecord *>(
+        section(header->agents, header->agent_count, sizeof(AgentRecord)));
+
+    // Make sure every wall is within the vertex array and is at least a triangle
+    if (m_view.wall_offsets[0] != 0 || m_view.wall_offsets[m_view.wall_count] != m_view.vertex_count)
+    {
+        fail("Invalid wall offsets");
+    }
+
+    for (uint32_t i = 0; i < m_view.wall_count; i++)
+    {
+        if (m_view.wall_offsets[i] > m_view.wall_offsets[i + 1] ||
+            m_view.wall_offsets[i + 1] - m_view.wall_offsets[i] < 3)
+        {
+            fail("Wall " + std::to_string(i) + " has fewer than three vertices");
+        }
+    }
+
+    // Objects can't have negative coordinates
+    for (uint32_t i = 0; i < m_view.vertex_count; i++)
+    {
+        const auto &p = m_view.vertices[i];
+
+        if (!std::isfinite(p.x) || !std::isfinite(p.y) || p.x < 0 || p.y < 0)
+        {
+            fail("Invalid vertex " + std::to_string(i));
+        }
+    }
+
+    for (uint32_t i = 0; i < m_view.agent_count; i++)
+    {
+        const auto &a = m_view.agents[i];
+
+        if (!std::isfinite(a.position.x) || !std::isfinite(a.position.y) || !std::isfinite(a.rotation))
+        {
+            fail("Invalid agent " + std::to_string(i));
+        }
+    }
+}
+
+SceneFile::~SceneFile()
+{
+    unmap();
+}
+
+void SceneFile::unmap()
+{
+#ifdef _WIN32
+    if (m_data)
+    {
+        UnmapViewOfFile(m_data);
+    }
+
+    if (m_mapping)
+    {
+        CloseHandle(m_mapping);
+    }
+
+    if (m_file)
+    {
+        CloseHandle(m_file);
+    }
+
+    m_mapping = nullptr;
+    m_file = nullptr;
+#else
+    if (m_data)
+    {
+        munmap(m_data, m_size);
+    }
+#endif
+
+    m_data = nullptr;
+}
+
+const SceneView &SceneFile::view() const
+{
+    return m_view;
+}
+
+//
+// Saving
+//
+
+void save_scene(const std::string &filename, const SceneView &scene)
+{
+    SceneHeader header{};
+    memcpy(header.magic, MAGIC, sizeof(MAGIC));
+    header.version = SceneHeader::VERSION;
+    header.wall_count = scene.wall_count;
+    header.vertex_count = scene.vertex_count;
+    header.agent_count = scene.agent_count;
+    header.wall_offsets = align(sizeof(header));
+    header.vertices = align(header.wall_offsets + (scene.wall_count + 1) * sizeof(uint32_t));
+    header.agents = align(header.vertices + scene.vertex_count * sizeof(Point));
+
+    std::ofstream file(filename, std::ios::binary | std::ios::trunc);
+
+    if (!file)
+    {
+        throw Error("Could not open " + filename + " for writing");
+    }
+
+    auto write_at = [&](uint64_t offset, const void *data, size_t size)
+    {
+        while ((uint64_t)file.tellp() < offset)
+        {
+            file.put(0);
+        }
+
+        file.write(static_cast<const char *>(data), size);
+    };
+
+    write_at(0, &header, sizeof(header));
+    write_at(header.wall_offsets, scene.wall_offsets, (scene.wall_count + 1) * sizeof(uint32_t));
+    write_at(header.vertices, scene.vertices, scene.vertex_count * sizeof(Point));
+    write_at(header.agents, scene.agents, scene.agent_count * sizeof(AgentRecord));
+
+    if (!file.flush())
+    {
+        throw Error("Failed to write scene to " + filename);
+    }
+}
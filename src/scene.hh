@@ -0,0 +1,108 @@
+#pragma once
+
+#include "common.hh"
+#include "objects.hh"
+
+#include <vector>
+
+// A binary scene file that can be memory-mapped and used in place. All integers are little-endian and every
+// section starts at an offset aligned to eight bytes:
+//
+//   SceneHeader
+//   uint32_t    wall_offsets[wall_count + 1]  Index of the first vertex of each wall, the last one is vertex_count
+//   Point       vertices[vertex_count]        The outlines of all walls in world coordinates
+//   AgentRecord agents[agent_count]           The navigators
+struct SceneHeader
+{
+    static constexpr uint32_t VERSION = 1;
+
+    char magic[4];
+    uint32_t version;
+    uint32_t wall_count;
+    uint32_t vertex_count;
+    uint32_t agent_count;
+    uint32_t reserved;
+    uint64_t wall_offsets;
+    uint64_t vertices;
+    uint64_t agents;
+};
+
+struct AgentRecord
+{
+    enum Flags : uint32_t
+    {
+        ACTIVE = 1 << 0,
+        COLLISION = 1 << 1,
+    };
+
+    Point position;
+    double rotation;
+    uint32_t flags;
+    uint32_t reserved;
+};
+
+static_assert(sizeof(Point) == 2 * sizeof(double), "Points must be stored as two doubles");
+static_assert(sizeof(SceneHeader) == 48 && sizeof(AgentRecord) == 32, "Scene records must not have padding");
+
+// A read-only view into the flat arrays of a scene
+struct SceneView
+{
+    const uint32_t *wall_offsets = nullptr;
+    uint32_t wall_count = 0;
+    const Point *vertices = nullptr;
+    uint32_t vertex_count = 0;
+    const AgentRecord *agents = nullptr;
+    uint32_t agent_count = 0;
+
+    // The outline of a wall as a range of vertices
+    std::pair<const Point *, const Point *> wall(size_t i) const
+    {
+        return {vertices + wall_offsets[i], vertices + wall_offsets[i + 1]};
+    }
+};
+
+// A scene that's built in memory
+class SceneData
+{
+public:
+    SceneData();
+
+    void add_wall(const std::vector<Point> &outline);
+
+    void add_agent(Point position, double rotation, bool active, bool collision);
+
+    SceneView view() const;
+
+private:
+    std::vector<uint32_t> m_wall_offsets;
+    std::vector<Point> m_vertices;
+    std::vector<AgentRecord> m_agents;
+};
+
+// A scene file mapped into memory. The view stays valid as long as the object exists.
+class SceneFile
+{
+public:
+    SceneFile(const SceneFile &) = delete;
+    SceneFile &operator=(const SceneFile &) = delete;
+
+    SceneFile(const std::string &filename);
+
+    ~SceneFile();
+
+    const SceneView &view() const;
+
+private:
+    void unmap();
+
+    void *m_data{nullptr};
+    size_t m_size{0};
+#ifdef _WIN32
+    void *m_file{nullptr};
+    void *m_mapping{nullptr};
+#endif
+    SceneView m_view;
+};
+
+// Write a scene into a file
+void save_scene(const std::string &filename, const SceneView &scene);
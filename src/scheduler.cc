@@ -0,0 +1,135 @@
+#include "scheduler.hh"
+
+#include <algorithm>
+#include <thread>
+
+namespace
+{
+    thread_local size_t t_worker = 0;
+}
+
+WorkStealingPool::WorkStealingPool(size_t threads)
+{
+    if (threads == 0)
+    {
+        threads = std::max(1u, std::thread::hardware_concurrency());
+    }
+
+    for (size_t i = 0; i < threads; i++)
+    {
+        m_queues.push_back(std::make_unique<Queue>());
+    }
+}
+
+void WorkStealingPool::run(std::vector<Task> tasks)
+{
+    m_steals = 0;
+    m_failed = false;
+    m_error = nullptr;
+
+    for (size_t i = 0; i < tasks.size(); i++)
+    {
+        m_queues[i % m_queues.size()]->tasks.push_back(std::move(tasks[i]));
+    }
+
+    // Tasks don't add new tasks so a thread can stop as soon as it finds every deque empty
+    std::vector<std::thread> threads;
+
+    for (size_t i = 1; i < m_queues.size(); i++)
+    {
+        threads.emplace_back(&WorkStealingPool::work, this, i);
+    }
+
+    work(0);
+
+    for (auto &t : threads)
+    {
+        t.join();
+    }
+
+    if (m_error)
+    {
+        for (auto &q : m_queues)
+        {
+            q->tasks.clear();
+        }
+
+        std::rethrow_exception(m_error);
+    }
+}
+
+size_t WorkStealingPool::threads() const
+{
+    return m_queues.size();
+}
+
+uint64_t WorkStealingPool::steals() const
+{
+    return m_steals;
+}
+
+// static
+size_t WorkStealingPool::worker()
+{
+    return t_worker;
+}
+
+void WorkStealingPool::work(size_t self)
+{
+    t_worker = self;
+    Task task;
+
+    while (!m_failed && (pop(self, task) || steal(self, task)))
+    {
+        try
+        {
+            task();
+        }
+        catch (...)
+        {
+            std::lock_guard guard(m_error_lock);
+
+            if (!m_error)
+            {
+                m_error = std::current_exception();
+            }
+
+            m_failed = true;
+        }
+    }
+}
+
+bool WorkStealingPool::pop(size_t self, Task &task)
+{
+    auto &q = *m_queues[self];
+    std::lock_guard guard(q.lock);
+
+    if (q.tasks.empty())
+    {
+        return false;
+    }
+
+    task = std::move(q.tasks.back());
+    q.tasks.pop_back();
+    return true;
+}
+
+bool WorkStealingPool::steal(size_t self, Task &task)
+{
+    // Start from the next thread so that the thieves don't all go after the same victim
+    for (size_t i = 1; i < m_queues.size(); i++)
+    {
+        auto &q = *m_queues[(self + i) % m_queues.size()];
+        std::lock_guard guard(q.lock);
+
+        if (!q.tasks.empty())
+        {
+            task = std::move(q.tasks.front());
+            q.tasks.pop_front();
+            ++m_steals;
+            return true;
+        }
+    }
+
+    return false;
+}
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+// Runs independent tasks on a fixed number of threads. Every thread has a deque of its own that it takes tasks
+// from the back of. When it runs out, it steals from the front of the other threads' deques so that a few long
+// tasks at the end don't leave the rest of the threads idle.
+class WorkStealingPool
+{
+public:
+    using Task = std::function<void()>;
+
+    // Zero threads uses one thread per core
+    WorkStealingPool(size_t threads = 0);
+
+    WorkStealingPool(const WorkStealingPool &) = delete;
+    WorkStealingPool &operator=(const WorkStealingPool &) = delete;
+
+    // Runs the tasks and returns when all of them are done. The tasks are dealt out to the threads in order. If
+    // a task throws, the remaining tasks are skipped and the first exception is rethrown.
+    void run(std::vector<Task> tasks);
+
+    size_t threads() const;
+
+    // The number of tasks that were stolen from another thread during the last run()
+    uint64_t steals() const;
+
+    // The index of the pool thread that calls this, only valid inside a task
+    static size_t worker();
+
+private:
+    struct Queue
+    {
+        std::mutex lock;
+        std::deque<Task> tasks;
+    };
+
+    void work(size_t self);
+
+    bool pop(size_t self, Task &task);
+
+    bool steal(size_t self, Task &task);
+
+    std::vector<std::unique_ptr<Queue>> m_queues;
+    std::atomic<uint64_t> m_steals{0};
+    std::atomic<bool> m_failed{false};
+    std::exception_ptr m_error;
+    std::mutex m_error_lock;
+};
@@ -0,0 +1,214 @@
+#pragma once
+
+#include "objects.hh"
+
+#include <cmath>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+// A uniform hash grid that maps rectangles in world coordinates to the items that overlap them. Items are
+// stored by pointer and are identified by the slot returned from insert().
+template <class T>
+class SpatialGrid
+{
+public:
+    static constexpr uint32_t NO_SLOT = UINT32_MAX;
+
+    SpatialGrid(double cell_size = 64.0)
+        : m_cell_size(cell_size)
+    {
+    }
+
+    // Add an item to the grid, returns the slot that identifies it
+    uint32_t insert(T *item, const Rect &rect)
+    {
+        uint32_t slot;
+
+        if (m_free.empty())
+        {
+            slot = m_items.size();
+            m_items.emplace_back();
+        }
+        else
+        {
+            slot = m_free.back();
+            m_free.pop_back();
+        }
+
+        auto &entry = m_items[slot];
+        entry.item = item;
+        entry.range = to_range(rect);
+        entry.stamp = 0;
+        ++m_size;
+
+        add_cells(slot, entry.range);
+        return slot;
+    }
+
+    // Move an item to a new location. Nothing is done if it stays in the same set of cells.
+    void update(uint32_t slot, const Rect &rect)
+    {
+        auto &entry = m_items[slot];
+        auto range = to_range(rect);
+
+        if (range != entry.range)
+        {
+            remove_cells(slot, entry.range);
+            entry.range = range;
+            add_cells(slot, entry.range);
+        }
+    }
+
+    void remove(uint32_t slot)
+    {
+        auto &entry = m_items[slot];
+        remove_cells(slot, entry.range);
+        entry.item = nullptr;
+        m_free.push_back(slot);
+        --m_size;
+    }
+
+    size_t size() const
+    {
+        return m_size;
+    }
+
+    double cell_size() const
+    {
+        return m_cell_size;
+    }
+
+    // Calls func once for every item whose cells overlap the rectangle
+    template <class Func>
+    void for_each(const Rect &rect, Func &&func)
+    {
+        any_of(rect, [&](T *item)
+               {
+                   func(item);
+                   return false;
+               });
+    }
+
+    // Calls pred for items whose cells overlap the rectangle until it returns true
+    template <class Func>
+    bool any_of(const Rect &rect, Func &&pred)
+    {
+        auto range = to_range(rect);
+        ++m_stamp;
+
+        for (int32_t y = range.y0; y <= range.y1; y++)
+        {
+            for (int32_t x = range.x0; x <= range.x1; x++)
+            {
+                auto it = m_cells.find(key(x, y));
+
+                if (it == m_cells.end())
+                {
+                    continue;
+                }
+
+                for (auto slot : it->second)
+                {
+                    auto &entry = m_items[slot];
+
+                    // Items that span multiple cells are only reported once per query
+                    if (entry.stamp != m_stamp)
+                    {
+                        entry.stamp = m_stamp;
+
+                        if (pred(entry.item))
+                        {
+                            return true;
+                        }
+                    }
+                }
+            }
+        }
+
+        return false;
+    }
+
+    // Calls func with the world rectangle of every non-empty cell
+    template <class Func>
+    void for_each_cell(Func &&func) const
+    {
+        for (const auto &[k, slots] : m_cells)
+        {
+            if (!slots.empty())
+            {
+                double x = (int32_t)(k >> 32);
+                double y = (int32_t)(k & 0xffffffff);
+                func(Rect{{x * m_cell_size, y * m_cell_size}, {(x + 1) * m_cell_size, (y + 1) * m_cell_size}});
+            }
+        }
+    }
+
+private:
+    struct Range
+    {
+        int32_t x0, y0, x1, y1;
+
+        bool operator!=(const Range &rhs) const
+        {
+            return x0 != rhs.x0 || y0 != rhs.y0 || x1 != rhs.x1 || y1 != rhs.y1;
+        }
+    };
+
+    struct Entry
+    {
+        T *item = nullptr;
+        Range range;
+        uint64_t stamp = 0;
+    };
+
+    static uint64_t key(int32_t x, int32_t y)
+    {
+        return ((uint64_t)(uint32_t)x << 32) | (uint32_t)y;
+    }
+
+    Range to_range(const Rect &rect) const
+    {
+        return {(int32_t)std::floor(rect.first.x / m_cell_size), (int32_t)std::floor(rect.first.y / m_cell_size),
+                (int32_t)std::floor(rect.second.x / m_cell_size), (int32_t)std::floor(rect.second.y / m_cell_size)};
+    }
+
+    void add_cells(uint32_t slot, const Range &range)
+    {
+        for (int32_t y = range.y0; y <= range.y1; y++)
+        {
+            for (int32_t x = range.x0; x <= range.x1; x++)
+            {
+                m_cells[key(x, y)].push_back(slot);
+            }
+        }
+    }
+
+    void remove_cells(uint32_t slot, const Range &range)
+    {
+        for (int32_t y = range.y0; y <= range.y1; y++)
+        {
+            for (int32_t x = range.x0; x <= range.x1; x++)
+            {
+                auto &cell = m_cells[key(x, y)];
+
+                for (auto &s : cell)
+                {
+                    if (s == slot)
+                    {
+                        s = cell.back();
+                        cell.pop_back();
+                        break;
+                    }
+                }
+            }
+        }
+    }
+
+    double m_cell_size;
+    std::unordered_map<uint64_t, std::vector<uint32_t>> m_cells;
+    std::vector<Entry> m_items;
+    std::vector<uint32_t> m_free;
+    size_t m_size = 0;
+    uint64_t m_stamp = 0;
+};
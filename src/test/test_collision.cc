@@ -1,22 +1,37 @@
+#include "../generator.hh"
 #include "../objects.hh"
+#include "../world.hh"
 
-#include <vector>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <functional>
 #include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+// Checks the optimized collision paths against straightforward reference implementations. The random cases are
+// seeded, pass a seed as the first argument to run a different set of them. Cases that are too close to a
+// degenerate configuration for the floating point results to be meaningful are counted but not compared.
 
 struct TestObject : public Object
 {
 public:
-    TestObject()
-        : Object({
-              {0, 0},
-              {0, 10},
-              {10, 10},
-              {10, 0},
-          })
+    TestObject(World &world,
+               std::vector<Point> pts = {
+                   {0, 0},
+                   {0, 10},
+                   {10, 10},
+                   {10, 0},
+               },
+               Mobility mobility = Mobility::DYNAMIC)
+        : Object(world, std::move(pts), mobility)
     {
     }
 
-    void tick()
+    void tick(int steps)
     {
     }
 
@@ -25,23 +40,461 @@ public:
     }
 };
 
-int main(int argc, char **argv)
+namespace
 {
-    TestObject n1, n2;
+    // Orientation values smaller than this are treated as degenerate in the random cases
+    constexpr double EPSILON = 1e-6;
+
+    int s_failures = 0;
+
+    void check(bool ok, const std::string &what)
+    {
+        if (!ok)
+        {
+            std::cout << "FAILED: " << what << std::endl;
+            s_failures++;
+        }
+    }
+
+    // A star-shaped polygon that fits inside a square of size 2 * radius
+    std::vector<Point> random_polygon(Random &rng, double radius)
+    {
+        bool convex = rng.integer(0, 1);
+        return star_polygon(rng, {radius, radius}, radius, convex, 16);
+    }
+
+    std::unique_ptr<TestObject> random_object(World &world, Random &rng, double area)
+    {
+        auto obj = std::make_unique<TestObject>(world, random_polygon(rng, rng.uniform(5, 40)));
+        obj->set_position({rng.uniform(0, area), rng.uniform(0, area)});
+        obj->set_rotation(rng.uniform(0, 360));
+        return obj;
+    }
+
+    //
+    // Reference implementations
+    //
+
+    double orientation(const Point &a, const Point &b, const Point &c)
+    {
+        return (b - a).cross(c - a);
+    }
+
+    bool between(double a, double b, double v)
+    {
+        return std::min(a, b) <= v && v <= std::max(a, b);
+    }
+
+    // Closed segment intersection, touching endpoints and collinear overlaps count as intersections. Sets
+    // degenerate if the answer depends on an orientation that is within EPSILON of zero.
+    bool segments_intersect(const Line &l1, const Line &l2, bool &degenerate)
+    {
+        const auto &[p1, p2] = l1;
+        const auto &[q1, q2] = l2;
+        double o1 = orientation(p1, p2, q1);
+        double o2 = orientation(p1, p2, q2);
+        double o3 = orientation(q1, q2, p1);
+        double o4 = orientation(q1, q2, p2);
+
+        if (fabs(o1) < EPSILON || fabs(o2) < EPSILON || fabs(o3) < EPSILON || fabs(o4) < EPSILON)
+        {
+            degenerate = degenerate || o1 != 0 || o2 != 0 || o3 != 0 || o4 != 0;
+        }
+
+        if (o1 == 0 && o2 == 0)
+        {
+            // Collinear, the segments intersect if their projections overlap
+            return (between(p1.x, p2.x, q1.x) && between(p1.y, p2.y, q1.y)) ||
+                   (between(p1.x, p2.x, q2.x) && between(p1.y, p2.y, q2.y)) ||
+                   (between(q1.x, q2.x, p1.x) && between(q1.y, q2.y, p1.y));
+        }
+
+        auto on = [](const Point &a, const Point &b, const Point &p)
+        {
+            return between(a.x, b.x, p.x) && between(a.y, b.y, p.y);
+        };
+
+        if ((o1 == 0 && on(p1, p2, q1)) || (o2 == 0 && on(p1, p2, q2)) ||
+            (o3 == 0 && on(q1, q2, p1)) || (o4 == 0 && on(q1, q2, p2)))
+        {
+            return true;
+        }
+
+        return (o1 > 0) != (o2 > 0) && o1 != 0 && o2 != 0 && (o3 > 0) != (o4 > 0) && o3 != 0 && o4 != 0;
+    }
+
+    // Two objects collide if any of their edges intersect
+    bool reference_collision(const Object &a, const Object &b, bool &degenerate)
+    {
+        auto la = a.lines();
+        auto lb = b.lines();
+        bool result = false;
+
+        for (const auto &l1 : la)
+        {
+            for (const auto &l2 : lb)
+            {
+                result = segments_intersect(l1, l2, degenerate) || result;
+            }
+        }
+
+        return result;
+    }
+
+    // Crossing number with a horizontal ray, points close to the boundary or to the x coordinate of a vertex
+    // (where the vertical rays of is_inside() go through a vertex) are degenerate.
+    bool reference_inside(const Object &obj, const Point &p, bool &degenerate)
+    {
+        auto pts = obj.points();
+        bool inside = false;
+
+        for (size_t i = 0; i < pts.size(); i++)
+        {
+            const auto &a = pts[i];
+            const auto &b = pts[(i + 1) % pts.size()];
+
+            if (fabs(a.x - p.x) < EPSILON || fabs(orientation(a, b, p)) < EPSILON)
+            {
+                degenerate = true;
+            }
+
+            if ((a.y > p.y) != (b.y > p.y) && p.x < a.x + (p.y - a.y) * (b.x - a.x) / (b.y - a.y))
+            {
+                inside = !inside;
+            }
+        }
+
+        return inside;
+    }
+
+    Rect reference_rect(const Object &obj)
+    {
+        auto pts = obj.points();
+        Rect rect{pts.front(), pts.front()};
+
+        for (const auto &p : pts)
+        {
+            rect.first.x = std::min(rect.first.x, p.x);
+            rect.first.y = std::min(rect.first.y, p.y);
+            rect.second.x = std::max(rect.second.x, p.x);
+            rect.second.y = std::max(rect.second.y, p.y);
+        }
+
+        return rect;
+    }
+
+    //
+    // Comparisons
+    //
+
+    // Counts the results of one comparison and the time spent in both implementations
+    class Comparison
+    {
+    public:
+        Comparison(std::string name)
+            : m_name(std::move(name))
+        {
+        }
+
+        template <class Fast, class Reference>
+        void compare(Fast fast, Reference reference, const std::string &what)
+        {
+            bool degenerate = false;
+
+            auto t0 = std::chrono::steady_clock::now();
+            auto expected = reference(degenerate);
+            auto t1 = std::chrono::steady_clock::now();
+            auto result = fast();
+            auto t2 = std::chrono::steady_clock::now();
+
+            m_reference += t1 - t0;
+            m_fast += t2 - t1;
+            m_cases++;
+
+            if (degenerate)
+            {
+                m_degenerate++;
+            }
+            else if (!(result == expected))
+            {
+                m_mismatches++;
+                check(false, m_name + ": " + what);
+            }
+        }
+
+        void report() const
+        {
+            double fast = std::chrono::duration<double, std::micro>(m_fast).count();
+            double reference = std::chrono::duration<double, std::micro>(m_reference).count();
+
+            std::cout << m_name << ": " << m_cases << " cases, " << m_mismatches << " mismatches, "
+                      << m_degenerate << " degenerate, fast " << fast / m_cases << " us/op, reference "
+                      << reference / m_cases << " us/op, speedup " << (fast > 0 ? reference / fast : 0) << "x"
+                      << std::endl;
+        }
+
+    private:
+        std::string m_name;
+        int m_cases = 0;
+        int m_mismatches = 0;
+        int m_degenerate = 0;
+        std::chrono::steady_clock::duration m_fast{0};
+        std::chrono::steady_clock::duration m_reference{0};
+    };
 
-    n1.set_position({0, 0});
-    n2.set_position({5, 5});
-    std::cout << "Collision 1: " << (n1.collision(n2) ? "Yes" : "No") << std::endl;
+    void test_basic()
+    {
+        World world;
+        TestObject n1(world), n2(world);
+
+        n1.set_position({0, 0});
+        n2.set_position({5, 5});
+        check(n1.collision(n2), "overlapping squares collide");
+
+        n2.set_position({0, 2.05});
+        n2.set_rotation(45);
+        check(n1.collision(n2), "rotated square collides");
+
+        n2.set_position({0, 20});
+        n2.set_rotation(0);
+        check(!n1.collision(n2), "separate squares don't collide");
+    }
+
+    // Touching and collinear edges on integer coordinates where the answer is exact
+    void test_edge_cases()
+    {
+        struct Case
+        {
+            const char *name;
+            std::vector<Point> a;
+            std::vector<Point> b;
+            bool expected;
+        };
+
+        std::vector<Case> cases = {
+            {"shared edge", {{0, 0}, {10, 0}, {10, 10}, {0, 10}}, {{10, 0}, {20, 0}, {20, 10}, {10, 10}}, true},
+            {"shared corner", {{0, 0}, {10, 0}, {10, 10}, {0, 10}}, {{10, 10}, {20, 10}, {20, 20}, {10, 20}}, true},
+            {"partially shared edge", {{0, 0}, {10, 0}, {10, 10}, {0, 10}}, {{5, 10}, {15, 10}, {15, 20}, {5, 20}}, true},
+            {"vertex on edge", {{0, 0}, {10, 0}, {10, 10}, {0, 10}}, {{5, 10}, {10, 20}, {0, 20}}, true},
+            {"collinear with gap", {{0, 0}, {10, 0}, {10, 10}, {0, 10}}, {{12, 0}, {20, 0}, {20, 10}, {12, 10}}, false},
+            {"parallel edges", {{0, 0}, {10, 0}, {10, 10}, {0, 10}}, {{0, 11}, {10, 11}, {10, 20}, {0, 20}}, false},
+            {"contained edge", {{0, 0}, {20, 0}, {20, 10}, {0, 10}}, {{5, 10}, {15, 10}, {10, 20}}, true},
+            {"nested", {{0, 0}, {20, 0}, {20, 20}, {0, 20}}, {{5, 5}, {15, 5}, {15, 15}, {5, 15}}, false},
+            {"crossing", {{0, 0}, {10, 0}, {10, 10}, {0, 10}}, {{5, 5}, {15, 5}, {15, 15}, {5, 15}}, true},
+        };
+
+        for (const auto &c : cases)
+        {
+            World world;
+            TestObject a(world, c.a);
+            TestObject b(world, c.b);
+            bool degenerate = false;
+
+            check(reference_collision(a, b, degenerate) == c.expected, std::string("reference: ") + c.name);
+            check(a.collision(b) == c.expected, std::string("a.collision(b): ") + c.name);
+            check(b.collision(a) == c.expected, std::string("b.collision(a): ") + c.name);
+        }
+    }
+
+    // The generator builds walls out of these, they must never intersect themselves
+    void test_star_polygons(Random &rng)
+    {
+        for (int i = 0; i < 2000; i++)
+        {
+            auto pts = star_polygon(rng, {100, 100}, 100, i % 2 == 0, 16);
+            size_t n = pts.size();
+            bool simple = true;
+
+            for (size_t a = 0; a < n; a++)
+            {
+                // Neighboring edges share a vertex, the last edge is a neighbor of the first one
+                for (size_t b = a + 2; b < n - (a == 0); b++)
+                {
+                    bool degenerate = false;
+                    Line e1{pts[a], pts[(a + 1) % n]};
+                    Line e2{pts[b], pts[(b + 1) % n]};
+
+                    if (segments_intersect(e1, e2, degenerate) && !degenerate)
+                    {
+                        simple = false;
+                    }
+                }
+            }
+
+            check(simple, "star polygon " + std::to_string(i) + " is simple");
+        }
+    }
+
+    void test_pairs(Random &rng)
+    {
+        Comparison pairs("collision(other)");
+        Comparison inside("is_inside");
+        Comparison rects("world_rect");
+
+        for (int i = 0; i < 2000; i++)
+        {
+            World world;
+            auto a = random_object(world, rng, 60);
+            auto b = random_object(world, rng, 60);
+
+            pairs.compare([&]()
+                          { return a->collision(*b); },
+                          [&](bool &degenerate)
+                          { return reference_collision(*a, *b, degenerate); },
+                          "pair " + std::to_string(i));
+
+            rects.compare([&]()
+                          { return a->world_rect(); },
+                          [&](bool &)
+                          { return reference_rect(*a); },
+                          "object " + std::to_string(i));
+
+            const auto &[min, max] = a->world_rect();
+            Point p{rng.uniform(min.x, max.x), rng.uniform(min.y, max.y)};
+
+            inside.compare([&]()
+                           { return a->is_inside(p); },
+                           [&](bool &degenerate)
+                           { return reference_inside(*a, p, degenerate); },
+                           "point " + std::to_string(i));
+        }
+
+        pairs.report();
+        inside.report();
+        rects.report();
+    }
+
+    // collision() and find() go through the spatial index, compare them against a walk over every object
+    void test_world(Random &rng)
+    {
+        World world;
+        std::vector<std::unique_ptr<TestObject>> objects;
 
-    n2.set_position({0, 2.05});
-    n2.set_rotation(45);
-    std::cout << "Collision 2: " << (n1.collision(n2) ? "Yes" : "No") << std::endl;
+        for (int i = 0; i < 1000; i++)
+        {
+            auto obj = random_object(world, rng, 2000);
+
+            if (i % 10 == 0)
+            {
+                obj->set_collision_enabled(false);
+            }
+
+            objects.push_back(std::move(obj));
+        }
+
+        for (int i = 0; i < 100; i++)
+        {
+            std::vector<Point> pts = random_polygon(rng, rng.uniform(20, 100));
+
+            for (auto &p : pts)
+            {
+                p += Point{rng.uniform(0, 2000), rng.uniform(0, 2000)};
+            }
+
+            objects.push_back(std::make_unique<TestObject>(world, pts, Object::Mobility::STATIC));
+        }
+
+        Comparison collisions("collision()");
+        Comparison find("find()");
+
+        for (size_t i = 0; i < objects.size(); i++)
+        {
+            const auto &obj = *objects[i];
+
+            collisions.compare([&]()
+                               { return obj.collision(); },
+                               [&](bool &degenerate)
+                               {
+                                   if (!obj.is_collision_enabled())
+                                   {
+                                       return false;
+                                   }
+
+                                   bool result = false;
+
+                                   for (const auto &o : objects)
+                                   {
+                                       if (o.get() != &obj && o->is_collision_enabled())
+                                       {
+                                           result = reference_collision(obj, *o, degenerate) || result;
+                                       }
+                                   }
+
+                                   return result;
+                               },
+                               "object " + std::to_string(i));
+
+            Point p{rng.uniform(0, 2000), rng.uniform(0, 2000)};
+            Rect rect{p, p + Point{rng.uniform(0, 300), rng.uniform(0, 300)}};
+
+            find.compare([&]()
+                         {
+                             std::vector<Object *> result;
+                             world.find(rect, result);
+                             std::sort(result.begin(), result.end());
+                             return result;
+                         },
+                         [&](bool &)
+                         {
+                             std::vector<Object *> result;
+
+                             for (const auto &o : objects)
+                             {
+                                 if (overlaps(rect, o->world_rect()))
+                                 {
+                                     result.push_back(o.get());
+                                 }
+                             }
+
+                             std::sort(result.begin(), result.end());
+                             return result;
+                         },
+                         "rect " + std::to_string(i));
+        }
+
+        collisions.report();
+        find.report();
+    }
+
+    // Handles of destroyed objects must not resolve, even after their slots are reused
+    void test_registry()
+    {
+        World world;
+        auto a = std::make_unique<TestObject>(world);
+        auto b = std::make_unique<TestObject>(world);
+        auto c = std::make_unique<TestObject>(world);
+        auto handle_a = a->handle();
+        auto handle_b = b->handle();
+
+        check(world.size() == 3 && world.get(handle_b) == b.get(), "objects are registered");
+
+        b.reset();
+        check(world.size() == 2 && world.get(handle_b) == nullptr, "destroyed object is removed");
+        check(world.get(handle_a) == a.get() && world.get(c->handle()) == c.get(), "other handles stay valid");
+
+        auto d = std::make_unique<TestObject>(world);
+        check(d->handle().index == handle_b.index && world.get(handle_b) == nullptr, "reused slot gets a new generation");
+        check(std::count(world.objects().begin(), world.objects().end(), d.get()) == 1, "objects are dense");
+
+        World other;
+        TestObject e(other);
+        check(!e.collision() && other.size() == 1 && world.size() == 3, "worlds are independent");
+    }
+}
+
+int main(int argc, char **argv)
+{
+    uint64_t seed = argc > 1 ? strtoull(argv[1], nullptr, 10) : 1;
+    Random rng(seed);
+    std::cout << "Seed: " << seed << std::endl;
 
-    n2.set_position({0, 20});
-    n2.set_rotation(0);
-    std::cout << "Collision 3: " << (n1.collision(n2) ? "Yes" : "No") << std::endl;
+    test_basic();
+    test_edge_cases();
+    test_star_polygons(rng);
+    test_pairs(rng);
+    test_world(rng);
+    test_registry();
 
-    std::string line;
-    std::cin >> line;
-    return 0;
+    std::cout << (s_failures ? "FAILED" : "OK") << std::endl;
+    return s_failures ? 1 : 0;
 }
@@ -0,0 +1,280 @@
+#include "../generator.hh"
+#include "../grid.hh"
+#include "../planner.hh"
+
+#include <cmath>
+#include <cstdlib>
+#include <functional>
+#include <iostream>
+#include <limits>
+#include <queue>
+#include <string>
+#include <vector>
+
+// Checks the grid planners against straightforward reference implementations on random grids. The grids are
+// seeded, pass a seed as the first argument to run a different set of them.
+
+namespace
+{
+    constexpr double SQRT2 = 1.4142135623730951;
+
+    int s_failures = 0;
+
+    void check(bool ok, const std::string &what)
+    {
+        if (!ok)
+        {
+            std::cout << "FAILED: " << what << std::endl;
+            s_failures++;
+        }
+    }
+
+    OccupancyGrid random_grid(Random &rng)
+    {
+        OccupancyGrid grid(rng.integer(10, 80), rng.integer(10, 60));
+        double density = rng.uniform(0.05, 0.4);
+
+        for (int y = 0; y < grid.height(); y++)
+        {
+            for (int x = 0; x < grid.width(); x++)
+            {
+                grid.set_blocked(x, y, rng.uniform(0, 1) < density);
+            }
+        }
+
+        return grid;
+    }
+
+    GridCell random_free_cell(Random &rng, const OccupancyGrid &grid)
+    {
+        while (true)
+        {
+            GridCell c{rng.integer(0, grid.width() - 1), rng.integer(0, grid.height() - 1)};
+
+            if (!grid.is_blocked(c.x, c.y))
+            {
+                return c;
+            }
+        }
+    }
+
+    std::string describe(const GridCell &a, const GridCell &b)
+    {
+        return "(" + std::to_string(a.x) + "," + std::to_string(a.y) + ")-(" + std::to_string(b.x) + "," +
+               std::to_string(b.y) + ")";
+    }
+
+    //
+    // Reference implementations
+    //
+
+    // Dijkstra over the same 8-connected moves without corner cutting, the length of the shortest path from start
+    // to every cell
+    std::vector<double> reference_distances(const OccupancyGrid &grid, const GridCell &start)
+    {
+        using Entry = std::pair<double, uint32_t>;
+        std::vector<double> dist((size_t)grid.width() * grid.height(), std::numeric_limits<double>::infinity());
+        std::priority_queue<Entry, std::vector<Entry>, std::greater<Entry>> open;
+
+        dist[grid.index(start.x, start.y)] = 0;
+        open.push({0, grid.index(start.x, start.y)});
+
+        while (!open.empty())
+        {
+            auto [d, index] = open.top();
+            open.pop();
+
+            if (d > dist[index])
+            {
+                continue;
+            }
+
+            GridCell c = grid.cell(index);
+
+            for (int dy = -1; dy <= 1; dy++)
+            {
+                for (int dx = -1; dx <= 1; dx++)
+                {
+                    if ((!dx && !dy) || grid.is_blocked(c.x + dx, c.y + dy) ||
+                        (dx && dy && (grid.is_blocked(c.x + dx, c.y) || grid.is_blocked(c.x, c.y + dy))))
+                    {
+                        continue;
+                    }
+
+                    uint32_t next = grid.index(c.x + dx, c.y + dy);
+                    double nd = d + (dx && dy ? SQRT2 : 1);
+
+                    if (nd < dist[next])
+                    {
+                        dist[next] = nd;
+                        open.push({nd, next});
+                    }
+                }
+            }
+        }
+
+        return dist;
+    }
+
+    // The line between the cell centers is blocked if it touches any blocked cell, even at a single corner. In
+    // doubled coordinates the centers and the cell corners are all integers and the test is exact.
+    bool reference_line_of_sight(const OccupancyGrid &grid, const GridCell &a, const GridCell &b)
+    {
+        int64_t ax = 2 * a.x + 1, ay = 2 * a.y + 1;
+        int64_t bx = 2 * b.x + 1, by = 2 * b.y + 1;
+
+        for (int y = std::min(a.y, b.y); y <= std::max(a.y, b.y); y++)
+        {
+            for (int x = std::min(a.x, b.x); x <= std::max(a.x, b.x); x++)
+            {
+                if (!grid.is_blocked(x, y))
+                {
+                    continue;
+                }
+
+                // The box is within the bounding box of the segment, it touches the segment unless all of its
+                // corners are strictly on the same side of the line
+                bool below = false;
+                bool above = false;
+
+                for (int64_t cy : {2 * y, 2 * y + 2})
+                {
+                    for (int64_t cx : {2 * x, 2 * x + 2})
+                    {
+                        int64_t side = (bx - ax) * (cy - ay) - (by - ay) * (cx - ax);
+                        below = below || side <= 0;
+                        above = above || side >= 0;
+                    }
+                }
+
+                if (below && above)
+                {
+                    return false;
+                }
+            }
+        }
+
+        return true;
+    }
+
+    //
+    // Tests
+    //
+
+    void test_line_of_sight(Random &rng)
+    {
+        int cases = 0;
+
+        for (int i = 0; i < 50; i++)
+        {
+            auto grid = random_grid(rng);
+
+            for (int j = 0; j < 200; j++)
+            {
+                auto a = random_free_cell(rng, grid);
+                auto b = random_free_cell(rng, grid);
+
+                check(grid.line_of_sight(a, b) == reference_line_of_sight(grid, a, b),
+                      "line_of_sight " + describe(a, b) + " on grid " + std::to_string(i));
+                check(grid.line_of_sight(a, b) == grid.line_of_sight(b, a),
+                      "line_of_sight is symmetric " + describe(a, b));
+                cases++;
+            }
+        }
+
+        std::cout << "line_of_sight: " << cases << " cases" << std::endl;
+    }
+
+    void test_planners(Random &rng)
+    {
+        int queries = 0;
+        int unreachable = 0;
+        double astar_length = 0;
+        double theta_length = 0;
+        double lazy_length = 0;
+
+        for (int i = 0; i < 50; i++)
+        {
+            auto grid = random_grid(rng);
+            GridPlanner astar(grid, GridPlanner::Algorithm::A_STAR);
+            GridPlanner theta(grid, GridPlanner::Algorithm::THETA_STAR);
+            GridPlanner lazy(grid, GridPlanner::Algorithm::LAZY_THETA_STAR);
+            std::vector<GridCell> path;
+
+            for (int j = 0; j < 20; j++)
+            {
+                auto start = random_free_cell(rng, grid);
+                auto goal = random_free_cell(rng, grid);
+                auto what = describe(start, goal) + " on grid " + std::to_string(i);
+                double optimal = reference_distances(grid, start)[grid.index(goal.x, goal.y)];
+                bool reachable = optimal != std::numeric_limits<double>::infinity();
+                queries++;
+                unreachable += !reachable;
+
+                // A* must find a shortest path made out of valid moves
+                bool found = astar.find_path(start, goal, path);
+                check(found == reachable, "A* reachability " + what);
+
+                if (found && reachable)
+                {
+                    check(std::abs(GridPlanner::length(path) - optimal) < 1e-9, "A* length " + what);
+                    check(path.front() == start && path.back() == goal, "A* endpoints " + what);
+
+                    for (size_t k = 1; k < path.size(); k++)
+                    {
+                        int dx = std::abs(path[k].x - path[k - 1].x);
+                        int dy = std::abs(path[k].y - path[k - 1].y);
+                        check(dx <= 1 && dy <= 1 && grid.line_of_sight(path[k - 1], path[k]), "A* move " + what);
+                    }
+
+                    astar_length += optimal;
+                }
+
+                // The any-angle paths must connect the endpoints with straight segments that don't touch a
+                // blocked cell, and can't be shorter than a straight line
+                for (auto *planner : {&theta, &lazy})
+                {
+                    auto name = GridPlanner::algorithm_name(planner->algorithm()) + std::string(" ");
+                    found = planner->find_path(start, goal, path);
+                    check(found == reachable, name + "reachability " + what);
+
+                    if (!found || !reachable)
+                    {
+                        continue;
+                    }
+
+                    check(path.front() == start && path.back() == goal, name + "endpoints " + what);
+
+                    for (size_t k = 1; k < path.size(); k++)
+                    {
+                        check(grid.line_of_sight(path[k - 1], path[k]),
+                              name + "segment " + describe(path[k - 1], path[k]) + " of " + what);
+                    }
+
+                    double length = GridPlanner::length(path);
+                    double dx = goal.x - start.x;
+                    double dy = goal.y - start.y;
+                    check(length >= sqrt(dx * dx + dy * dy) - 1e-9, name + "length " + what);
+                    (planner == &theta ? theta_length : lazy_length) += length;
+                }
+            }
+        }
+
+        std::cout << "planners: " << queries << " queries, " << unreachable << " unreachable, path length relative "
+                  << "to A*: theta " << theta_length / astar_length << ", lazy-theta " << lazy_length / astar_length
+                  << std::endl;
+    }
+}
+
+int main(int argc, char **argv)
+{
+    uint64_t seed = argc > 1 ? strtoull(argv[1], nullptr, 10) : 1;
+    Random rng(seed);
+    std::cout << "Seed: " << seed << std::endl;
+
+    test_line_of_sight(rng);
+    test_planners(rng);
+
+    std::cout << (s_failures ? "FAILED" : "OK") << std::endl;
+    return s_failures ? 1 : 0;
+}
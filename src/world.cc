@@ -1,209 +1,105 @@
-#include <tuple>
-#include <cstdint>
-
 #include "world.hh"
 
-using namespace std;
+#include <cassert>
 
-// static
-std::unique_ptr<Wall> Wall::create(SDL_Renderer *renderer, std::vector<Point> outline)
-{
-    return std::unique_ptr<Wall>(new Wall(renderer, outline));
-}
+World::World() = default;
 
-Wall::Wall(SDL_Renderer *renderer, std::vector<Point> outline)
-    : Object(outline), m_polygon(this, renderer)
+Object *World::get(const ObjectHandle &handle) const
 {
-    m_polygon.set_fill(COLOR_GRAY);
-    m_polygon.set_outline(COLOR_GREEN);
-    m_polygon.redraw();
-}
+    if (handle.index < m_slots.size() && m_slots[handle.index].generation == handle.generation)
+    {
+        return m_objects[m_slots[handle.index].dense];
+    }
 
-void Wall::tick()
-{
+    return nullptr;
 }
 
-void Wall::state_changed(Object::ChangeType type)
+ObjectHandle World::add(Object *object)
 {
-}
+    uint32_t index;
 
-void Wall::render(SDL_Renderer *renderer) const
-{
-    m_polygon.render(renderer);
-}
+    if (m_free.empty())
+    {
+        index = m_slots.size();
+        m_slots.push_back({0, 0});
+    }
+    else
+    {
+        index = m_free.back();
+        m_free.pop_back();
+    }
 
-Navigator::Navigator(SDL_Renderer *renderer, std::vector<Point> outline)
-    : Object(outline), m_polygon(this, renderer)
-{
-    listen(SDL_MOUSEMOTION, &Navigator::on_mouse_move);
-    m_polygon.set_fill(COLOR_GREEN);
-    m_polygon.set_outline(COLOR_BLACK);
-    m_polygon.redraw();
-}
+    m_slots[index].dense = m_objects.size();
+    m_objects.push_back(object);
+    m_dense_slots.push_back(index);
+    ++m_changes;
 
-Navigator::Navigator(SDL_Renderer *renderer)
-    : Navigator(renderer, {
-                              {0, 0},
-                              {50, 0},
-                              {50, 50},
-                              {0, 50},
-                          })
-{
+    return {index, m_slots[index].generation};
 }
 
-// static
-std::unique_ptr<Navigator> Navigator::create(SDL_Renderer *renderer)
+void World::remove(const ObjectHandle &handle)
 {
-    return std::unique_ptr<Navigator>(new Navigator(renderer));
-}
+    assert(get(handle));
+    auto &slot = m_slots[handle.index];
 
-void Navigator::tick()
-{
-    set_position(position() + m_motion);
-    set_rotation(rotation() + m_rotation);
+    // Keep the array dense by moving the last object into the hole
+    uint32_t last = m_objects.size() - 1;
+    m_objects[slot.dense] = m_objects[last];
+    m_dense_slots[slot.dense] = m_dense_slots[last];
+    m_slots[m_dense_slots[slot.dense]].dense = slot.dense;
+    m_objects.pop_back();
+    m_dense_slots.pop_back();
 
-    if (collision())
-    {
-        set_position(position() - m_motion);
-        set_rotation(rotation() - m_rotation);
-        m_motion.x = 0;
-        m_motion.y = 0;
-        m_rotation = 0;
-    }
+    ++slot.generation;
+    m_free.push_back(handle.index);
+    ++m_changes;
 }
 
-Color Navigator::fill_color() const
+SpatialGrid<Object> &World::index_of(Object::Mobility mobility)
 {
-    if (!is_active())
-    {
-        return COLOR_GRAY;
-    }
-    else if (!is_collision_enabled())
-    {
-        return COLOR_MAGENTA;
-    }
-    else if (m_selected)
-    {
-        return COLOR_BLUE;
-    }
-    else
-    {
-        return COLOR_GREEN;
-    }
+    return mobility == Object::Mobility::STATIC ? m_static : m_dynamic;
 }
 
-Color Navigator::outline_color() const
+void World::find(const Rect &rect, std::vector<Object *> &result)
 {
-    if (m_hover || m_selected)
-    {
-        return COLOR_RED;
-    }
-    else
-    {
-        return COLOR_BLACK;
-    }
+    find(rect, Object::Mobility::STATIC, result);
+    find(rect, Object::Mobility::DYNAMIC, result);
 }
 
-void Navigator::state_changed(Object::ChangeType type)
+void World::find(const Rect &rect, Object::Mobility mobility, std::vector<Object *> &result)
 {
-    switch (type)
-    {
-    case Object::ChangeType::COLLISION:
-    case Object::ChangeType::ACTIVE:
-        m_polygon.set_fill(fill_color());
-        m_polygon.set_outline(outline_color());
-        m_polygon.redraw();
-        break;
-    }
+    index_of(mobility).for_each(rect, [&](Object *o)
+                                {
+                                    if (overlaps(rect, o->world_rect()))
+                                    {
+                                        result.push_back(o);
+                                    }
+                                });
 }
 
-void Navigator::render(SDL_Renderer *renderer) const
+void World::index_cells(Object::Mobility mobility, std::vector<Rect> &result) const
 {
-    m_polygon.render(renderer);
+    const auto &index = mobility == Object::Mobility::STATIC ? m_static : m_dynamic;
+    index.for_each_cell([&](const Rect &rect)
+                        { result.push_back(rect); });
 }
 
-void Navigator::on_mouse_move(const SDL_Event &event)
+const std::vector<Contact> &World::contacts() const
 {
-    Point mouse{(double)event.motion.x, (double)event.motion.y};
-    bool hover = is_inside(mouse);
-
-    if (m_hover != hover)
-    {
-        m_hover = hover;
-
-        m_polygon.set_outline(outline_color());
-        m_polygon.redraw();
-    }
+    return m_contacts;
 }
 
-void Navigator::on_key_up(const SDL_Event &event)
+void World::clear_contacts()
 {
-    switch (event.key.keysym.sym)
-    {
-    case SDLK_a:
-    case SDLK_d:
-        m_motion.x = 0;
-        break;
-
-    case SDLK_w:
-    case SDLK_s:
-        m_motion.y = 0;
-        break;
-
-    case SDLK_q:
-    case SDLK_e:
-        m_rotation = 0;
-        break;
-    }
+    m_contacts.clear();
 }
 
-void Navigator::on_key_down(const SDL_Event &event)
+uint64_t World::changes() const
 {
-    double speed = (SDL_GetModState() & KMOD_SHIFT) ? 0.1 : 1.0;
-
-    switch (event.key.keysym.sym)
-    {
-    case SDLK_a:
-        m_motion.x = -speed;
-        break;
-
-    case SDLK_d:
-        m_motion.x = speed;
-        break;
-
-    case SDLK_w:
-        m_motion.y = -speed;
-        break;
-
-    case SDLK_s:
-        m_motion.y = speed;
-        break;
-
-    case SDLK_q:
-        m_rotation = speed;
-        break;
-
-    case SDLK_e:
-        m_rotation = -speed;
-        break;
-    }
+    return m_changes;
 }
 
-void Navigator::set_selected(bool selected)
+EventGenerator &World::events()
 {
-    m_selected = selected;
-    m_polygon.set_fill(fill_color());
-    m_polygon.set_outline(outline_color());
-    m_polygon.redraw();
-
-    if (selected)
-    {
-        listen(SDL_KEYDOWN, &Navigator::on_key_down);
-        listen(SDL_KEYUP, &Navigator::on_key_up);
-    }
-    else
-    {
-        stop_listening(SDL_KEYDOWN);
-        stop_listening(SDL_KEYUP);
-    }
+    return m_events;
 }
@@ -1,58 +1,88 @@
 #pragma once
 
-#include "common.hh"
-#include "objects.hh"
 #include "events.hh"
-#include "graphics.hh"
-
-#include <memory>
-
-class Wall : public Object, public Renderable
+#include "objects.hh"
+#include "spatial.hh"
+
+#include <cstdint>
+#include <vector>
+
+// Everything an independent simulation needs: the registry of its objects, the spatial indexes used for
+// collision detection, the contacts found during the current tick and the event bus of its listeners. Objects
+// add themselves to the world they are constructed in and remove themselves when destroyed, the world does
+// not own them and it must outlive them.
+//
+// A world is not thread-safe but separate worlds share nothing, each one can be simulated on its own thread.
+class World
 {
 public:
-    static std::unique_ptr<Wall> create(SDL_Renderer *renderer, std::vector<Point> outline);
+    World();
+    World(const World &) = delete;
+    World &operator=(const World &) = delete;
 
-    ~Wall() = default;
+    // The object the handle refers to or nullptr if it has been destroyed
+    Object *get(const ObjectHandle &handle) const;
 
-    void tick() override;
+    // All objects in a contiguous array, in no particular order. Destroying an object moves the last object
+    // into its place.
+    const std::vector<Object *> &objects() const
+    {
+        return m_objects;
+    }
 
-    void state_changed(Object::ChangeType type) override;
+    size_t size() const
+    {
+        return m_objects.size();
+    }
 
-    void render(SDL_Renderer *renderer) const override;
+    // Find the objects whose world rectangles overlap the given rectangle. Static objects come first.
+    void find(const Rect &rect, std::vector<Object *> &result);
 
-private:
-    Wall(SDL_Renderer *renderer, std::vector<Point> outline);
-    Polygon m_polygon;
-};
+    // Find only the objects with the given mobility
+    void find(const Rect &rect, Object::Mobility mobility, std::vector<Object *> &result);
 
-class Navigator : public Object, public EventListener<Navigator>, public Renderable
-{
-public:
-    static std::unique_ptr<Navigator> create(SDL_Renderer *renderer);
+    // The non-empty cells of the spatial index used for the objects of the given mobility
+    void index_cells(Object::Mobility mobility, std::vector<Rect> &result) const;
 
-    void tick() override;
+    // The contacts found by Object::collision() since the last call to clear_contacts()
+    const std::vector<Contact> &contacts() const;
 
-    void state_changed(Object::ChangeType type) override;
+    // Clears the contact list, called at the start of every tick
+    void clear_contacts();
 
-    void render(SDL_Renderer *renderer) const override;
+    // A counter that's incremented whenever an object is created, destroyed, moved or changes state. If it
+    // hasn't changed, the world looks the same as before.
+    uint64_t changes() const;
 
-    void set_selected(bool is_selected);
+    EventGenerator &events();
 
 private:
-    Navigator(SDL_Renderer *renderer);
-    Navigator(SDL_Renderer *renderer, std::vector<Point> outline);
+    friend struct Object;
+
+    struct Slot
+    {
+        uint32_t dense;      // Position in m_objects
+        uint32_t generation;
+    };
+
+    ObjectHandle add(Object *object);
+
+    void remove(const ObjectHandle &handle);
+
+    SpatialGrid<Object> &index_of(Object::Mobility mobility);
 
-    void on_mouse_move(const SDL_Event &event);
-    void on_key_down(const SDL_Event &event);
-    void on_key_up(const SDL_Event &event);
+    std::vector<Object *> m_objects;
+    std::vector<uint32_t> m_dense_slots; // The slot of each object in m_objects
+    std::vector<Slot> m_slots;
+    std::vector<uint32_t> m_free;
 
-    Color fill_color() const;
+    // Walls and other static objects only move in the index when they are edited
+    SpatialGrid<Object> m_static;
 
-    Color outline_color() const;
+    // Objects that move around, updated whenever they change position or rotation
+    SpatialGrid<Object> m_dynamic;
 
-    Polygon m_polygon;
-    Point m_motion{0, 0};
-    double m_rotation = 0;
-    bool m_selected = false;
-    bool m_hover = false;
+    std::vector<Contact> m_contacts;
+    uint64_t m_changes = 0;
+    EventGenerator m_events;
 };